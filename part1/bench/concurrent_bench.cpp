@@ -0,0 +1,134 @@
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "my_concurrent_hash_table.h"
+
+using namespace std;
+
+// Scaling benchmark: MyConcurrentHashTable vs. a MyHashTable behind one mutex, with 1..N threads. The read-only runs
+// compare the lock-free gets (seqlock) with gets under the reader lock of the shard and gets of a MyHashTable without
+// any synchronization, once over all keys and once over a few hot keys that all threads read from the same shards.
+const unsigned long KEY_COUNT = 1 << 20;      // number of distinct keys, all inserted before measuring
+const unsigned long HOT_KEY_COUNT = 16;       // keys of the hot read-only run
+const unsigned long OPS_PER_THREAD = 1 << 21; // operations per thread
+const unsigned long WRITE_PERCENT = 10;       // share of inserts, the rest are gets
+
+/// @brief Run the workload on every thread and return the total number of operations per second.
+/// @param write_percent Share of the operations that are called with write = true.
+/// @param key_count The keys are drawn from [0, key_count).
+template <typename Operation>
+double run_threads(unsigned long thread_count, unsigned long write_percent, Operation operation, unsigned long key_count = KEY_COUNT)
+{
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (unsigned long t = 0; t < thread_count; t++)
+    {
+        threads.emplace_back([t, write_percent, key_count, &operation]()
+                             {
+            mt19937_64 random(t + 1);
+            for (unsigned long i = 0; i < OPS_PER_THREAD; i++)
+            {
+                uint64_t r = random();
+                operation(r % key_count, (r >> 32) % 100 < write_percent);
+            } });
+    }
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return thread_count * OPS_PER_THREAD / seconds;
+}
+
+int main()
+{
+    unsigned long max_threads = max(1u, thread::hardware_concurrency());
+
+    // Keys are 64-bit integers, so that the benchmark measures the hash tables and not string handling.
+    MyHashTable<uint64_t, uint64_t, MyWyHash> locked_table(KEY_COUNT, true);
+    mutex locked_table_mutex;
+    MyConcurrentHashTable<uint64_t, uint64_t, MyWyHash> concurrent_table(KEY_COUNT);
+    for (uint64_t key = 0; key < KEY_COUNT; key++)
+    {
+        locked_table.insert(key, key);
+        concurrent_table.insert(key, key);
+    }
+
+    cout << "--- Concurrent hash table: " << WRITE_PERCENT << "% inserts, " << KEY_COUNT << " keys, "
+         << concurrent_table.get_shard_count() << " shards ---" << endl;
+    cout << setw(8) << "Threads" << setw(20) << "Mutex [Mops/s]" << setw(20) << "Sharded [Mops/s]" << endl;
+    for (unsigned long thread_count = 1;; thread_count = min(thread_count * 2, max_threads))
+    {
+        double locked_ops = run_threads(thread_count, WRITE_PERCENT, [&](uint64_t key, bool write)
+                                        {
+            lock_guard<mutex> guard(locked_table_mutex);
+            if (write)
+            {
+                locked_table.insert(key, key);
+            }
+            else
+            {
+                uint64_t *volatile value = locked_table.get(key);
+                (void)value;
+            } });
+        double concurrent_ops = run_threads(thread_count, WRITE_PERCENT, [&](uint64_t key, bool write)
+                                            {
+            if (write)
+            {
+                concurrent_table.insert(key, key);
+            }
+            else
+            {
+                uint64_t value;
+                concurrent_table.get(key, value);
+            } });
+        cout << setw(8) << thread_count << setw(20) << fixed << setprecision(2) << locked_ops / 1e6
+             << setw(20) << concurrent_ops / 1e6 << endl;
+        if (thread_count == max_threads)
+        {
+            break;
+        }
+    }
+
+    // Read-only: without writers a MyHashTable (not in cache mode) may be read by all threads without any
+    // synchronization, the upper bound. The reader lock costs an atomic read-modify-write of the shard's cache line per
+    // get, which the threads contend on when they read the same shards. The seqlock only reads the shard's sequence
+    // number and writes the reader slot of its thread.
+    for (unsigned long key_count : {KEY_COUNT, HOT_KEY_COUNT})
+    {
+        cout << "--- Read-only, " << key_count << " keys: gets without a lock vs. reader lock vs. seqlock ---" << endl;
+        cout << setw(8) << "Threads" << setw(20) << "No lock [Mops/s]" << setw(24) << "Reader lock [Mops/s]"
+             << setw(20) << "Seqlock [Mops/s]" << endl;
+        for (unsigned long thread_count = 1;; thread_count = min(thread_count * 2, max_threads))
+        {
+            double unlocked_ops = run_threads(thread_count, 0, [&](uint64_t key, bool)
+                                              {
+                uint64_t *volatile value = locked_table.get(key);
+                (void)value; }, key_count);
+            double reader_lock_ops = run_threads(thread_count, 0, [&](uint64_t key, bool)
+                                                 {
+                uint64_t value;
+                concurrent_table.get_locked(key, value); }, key_count);
+            double seqlock_ops = run_threads(thread_count, 0, [&](uint64_t key, bool)
+                                             {
+                uint64_t value;
+                concurrent_table.get(key, value); }, key_count);
+            cout << setw(8) << thread_count << setw(20) << fixed << setprecision(2) << unlocked_ops / 1e6
+                 << setw(24) << reader_lock_ops / 1e6 << setw(20) << seqlock_ops / 1e6 << endl;
+            if (thread_count == max_threads)
+            {
+                break;
+            }
+        }
+    }
+
+    uint64_t key, value;
+    if (concurrent_table.get_last(key, value))
+    {
+        cout << "Last key: " << key << endl;
+    }
+}
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "my_hash_table.h"
+#include "my_mapped_file.h"
+#include "my_tokenizer.h"
+
+using namespace std;
+
+// Benchmark of MyHashTable: sweeps table size, load factor, hash policy and key set and prints the latency
+// per operation (median, p99, p999) and the statistics of the filled table. All keys are generated with fixed
+// seeds, thus runs are reproducible. Usage: hash_table_bench [book.txt] (the book key set is skipped without it)
+const unsigned long TABLE_SIZES[] = {1 << 12, 1 << 16, 1 << 20};
+const double LOAD_FACTORS[] = {0.5, 0.75, 0.875};
+const unsigned RANDOM_SEED = 42;
+
+/// @brief A named set of distinct keys.
+struct KeySet
+{
+    string name;
+    vector<string> keys;
+};
+
+/// @brief Latencies in nanoseconds of single operations.
+struct Latencies
+{
+    vector<double> values;
+
+    double percentile(double p)
+    {
+        size_t index = min(values.size() - 1, (size_t)(p * values.size()));
+        nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+};
+
+/// @brief Overhead of reading the clock twice, subtracted from every measurement.
+double clock_overhead()
+{
+    vector<double> values;
+    for (int i = 0; i < 10000; i++)
+    {
+        auto start = chrono::steady_clock::now();
+        auto end = chrono::steady_clock::now();
+        values.push_back(chrono::duration<double, nano>(end - start).count());
+    }
+    sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+/// @brief Time an operation per key.
+template <typename Operation>
+Latencies measure(const vector<string_view> &keys, double overhead, Operation operation)
+{
+    Latencies latencies;
+    latencies.values.reserve(keys.size());
+    for (string_view key : keys)
+    {
+        auto start = chrono::steady_clock::now();
+        operation(key);
+        auto end = chrono::steady_clock::now();
+        latencies.values.push_back(max(0.0, chrono::duration<double, nano>(end - start).count() - overhead));
+    }
+    return latencies;
+}
+
+void print_row(const string &keys, const char *policy, unsigned long size, double load, const char *operation,
+               Latencies &latencies, const MyHashTableStats &stats)
+{
+    cout << left << setw(12) << keys << setw(8) << policy << right << setw(9) << size << setw(7) << fixed << setprecision(3) << load
+         << "  " << left << setw(9) << operation << right << setprecision(1)
+         << setw(9) << latencies.percentile(0.5) << setw(9) << latencies.percentile(0.99) << setw(9) << latencies.percentile(0.999)
+         << setw(10) << setprecision(2) << stats.mean_displacement << setw(8) << stats.max_displacement
+         << setw(9) << setprecision(3) << stats.distribution_quality << endl;
+}
+
+/// @brief Run all sizes and load factors with one hash policy and key set.
+template <typename Hash>
+void run_policy(const char *policy, const KeySet &key_set, double overhead)
+{
+    mt19937 random(RANDOM_SEED);
+    for (unsigned long size : TABLE_SIZES)
+    {
+        for (double load : LOAD_FACTORS)
+        {
+            // The first half of the keys is inserted, the second half is used for misses.
+            size_t count = (size_t)(size * load);
+            if (2 * count > key_set.keys.size())
+            {
+                continue;
+            }
+            vector<string_view> keys(key_set.keys.begin(), key_set.keys.begin() + 2 * count);
+            shuffle(keys.begin(), keys.end(), random);
+            vector<string_view> inserted(keys.begin(), keys.begin() + count);
+            vector<string_view> missing(keys.begin() + count, keys.end());
+            vector<string_view> hits = inserted;
+            shuffle(hits.begin(), hits.end(), random);
+
+            MyHashTable<string, int, Hash> table(size);
+            Latencies inserts = measure(inserted, overhead, [&](string_view key)
+                                        { table.insert(key, 1); });
+            Latencies get_hits = measure(hits, overhead, [&](string_view key)
+                                         { if (table.get(key) == nullptr) cerr << "Missing key " << key << endl; });
+            Latencies get_misses = measure(missing, overhead, [&](string_view key)
+                                           { if (table.get(key) != nullptr) cerr << "Unexpected key " << key << endl; });
+            MyHashTableStats stats = table.get_stats();
+            print_row(key_set.name, policy, size, load, "insert", inserts, stats);
+            print_row(key_set.name, policy, size, load, "get hit", get_hits, stats);
+            print_row(key_set.name, policy, size, load, "get miss", get_misses, stats);
+        }
+    }
+}
+
+/// @brief Random keys of 4 to 24 letters and digits.
+KeySet random_keys(size_t count)
+{
+    const char characters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    mt19937 random(RANDOM_SEED);
+    MyHashTable<string, int> unique(1024, true);
+    KeySet key_set = {"random", {}};
+    while (key_set.keys.size() < count)
+    {
+        string key(4 + random() % 21, ' ');
+        for (char &c : key)
+        {
+            c = characters[random() % (sizeof(characters) - 1)];
+        }
+        if (unique.try_emplace(key, 0).second)
+        {
+            key_set.keys.push_back(key);
+        }
+    }
+    return key_set;
+}
+
+/// @brief Keys that only differ in a few digits ("key0", "key1", ...), a weak hash function clusters them.
+KeySet sequential_keys(size_t count)
+{
+    KeySet key_set = {"sequential", {}};
+    for (size_t i = 0; i < count; i++)
+    {
+        key_set.keys.push_back("key" + to_string(i));
+    }
+    return key_set;
+}
+
+/// @brief The distinct words of a text file.
+KeySet book_keys(const char *path)
+{
+    KeySet key_set = {"book", {}};
+    MyMappedFile file;
+    if (!file.open(path))
+    {
+        cerr << "Cannot open " << path << endl;
+        return key_set;
+    }
+    MyHashTable<string, int> unique(1024, true);
+    my_tokenize(file.view(), [&](string_view word)
+                { if (unique.try_emplace(word, 0).second) key_set.keys.emplace_back(word); });
+    return key_set;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t max_keys = (size_t)(2 * TABLE_SIZES[size(TABLE_SIZES) - 1] * LOAD_FACTORS[size(LOAD_FACTORS) - 1]);
+    vector<KeySet> key_sets;
+    if (argc > 1)
+    {
+        key_sets.push_back(book_keys(argv[1]));
+    }
+    key_sets.push_back(random_keys(max_keys));
+    key_sets.push_back(sequential_keys(max_keys));
+
+    double overhead = clock_overhead();
+    cout << "--- MyHashTable benchmark: group width " << MY_GROUP_WIDTH << ", clock overhead " << overhead << " ns (subtracted) ---" << endl;
+    cout << left << setw(12) << "Keys" << setw(8) << "Hash" << right << setw(9) << "Size" << setw(7) << "Load"
+         << "  " << left << setw(9) << "Op" << right << setw(9) << "p50[ns]" << setw(9) << "p99[ns]" << setw(9) << "p999[ns]"
+         << setw(10) << "Mean disp" << setw(8) << "Max" << setw(9) << "Quality" << endl;
+    for (const KeySet &key_set : key_sets)
+    {
+        run_policy<MyDjb2Hash>("djb2", key_set, overhead);
+        run_policy<MyFnv1aHash>("fnv1a", key_set, overhead);
+        run_policy<MyWyHash>("wyhash", key_set, overhead);
+        run_policy<MyCrc32Hash>("crc32", key_set, overhead);
+    }
+}
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "my_hash_table.h"
+
+#ifndef __MY_CONCURRENT_HASH_TABLE_H__
+#define __MY_CONCURRENT_HASH_TABLE_H__
+
+/// @brief Size of a cache line, shards are aligned to it to avoid false sharing between their locks.
+const size_t MY_CACHE_LINE_SIZE = 64;
+/// @brief Stamp of an empty shard, older than every item.
+const int64_t MY_NO_STAMP = INT64_MIN;
+/// @brief Threads that can read MyConcurrentHashTables without locking at the same time, see my_reader_slot().
+const unsigned MY_READER_SLOTS = 256;
+/// @brief Optimistic attempts of a get() before it takes the reader lock of the shard (writers keep changing it).
+const unsigned MY_OPTIMISTIC_READ_ATTEMPTS = 8;
+
+/// @brief Value stored in the shards of MyConcurrentHashTable: the value and the time of its last change.
+template <typename Value>
+struct MyStampedValue
+{
+    Value value;
+    int64_t stamp;
+};
+
+/// @brief Print the value of a MyStampedValue, e.g. for the error message of a full shard.
+template <typename Value>
+std::ostream &operator<<(std::ostream &out, const MyStampedValue<Value> &stamped)
+{
+    return out << stamped.value;
+}
+
+/// @brief Reader slot of a thread, on its own cache line: set while the thread reads a MyConcurrentHashTable
+/// without locking. It is written by its owner only, so readers don't write to a shared cache line.
+struct alignas(MY_CACHE_LINE_SIZE) MyReaderSlot
+{
+    std::atomic<bool> reading{false};
+    std::atomic<bool> owned{false};
+};
+
+/// @brief Reader slots of all MyConcurrentHashTables.
+inline MyReaderSlot *my_reader_slots()
+{
+    static MyReaderSlot slots[MY_READER_SLOTS];
+    return slots;
+}
+
+/// @brief Owns a reader slot for the lifetime of a thread and releases it when the thread ends.
+struct MyReaderSlotOwner
+{
+    MyReaderSlot *slot = nullptr;
+    bool claimed = false;
+
+    ~MyReaderSlotOwner()
+    {
+        if (this->slot != nullptr)
+        {
+            this->slot->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+/// @brief Get the reader slot of the calling thread, claimed on its first read.
+/// @return nullptr if all MY_READER_SLOTS are owned by other threads.
+inline MyReaderSlot *my_reader_slot()
+{
+    thread_local MyReaderSlotOwner owner;
+    if (!owner.claimed)
+    {
+        owner.claimed = true;
+        for (unsigned i = 0; i < MY_READER_SLOTS && owner.slot == nullptr; i++)
+        {
+            bool owned = false;
+            if (my_reader_slots()[i].owned.compare_exchange_strong(owned, true))
+            {
+                owner.slot = my_reader_slots() + i;
+            }
+        }
+    }
+    return owner.slot;
+}
+
+/// @brief Get a timestamp in nanoseconds for the recency order across shards.
+/// @details A clock instead of a shared counter: a counter would be a single cache line written by all threads.
+inline int64_t my_stamp_now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Thread-safe hash table that splits the keys over independent MyHashTable shards.
+/// @details Writers lock the shard of their key, thus writers of different shards don't block each other.
+/// get() does not lock (seqlock): every shard has a sequence number that a writer makes odd while it changes the
+/// shard. A reader copies the slot table references, probes and copies the value, and retries if the sequence
+/// number changed meanwhile (MyHashTable::get_in_view() never leaves the memory of the table, even if it reads
+/// half-written data). Thus readers write no shared cache line: they only flag the reader slot of their thread
+/// (my_reader_slot()), which is how a writer knows when a slot table that the incremental migration of MyHashTable
+/// replaced can be freed: only after every reader slot has been seen without a reader. If writers keep a shard busy,
+/// get() takes the reader lock after MY_OPTIMISTIC_READ_ATTEMPTS attempts, as it does for values that are not
+/// trivially copyable and for threads beyond MY_READER_SLOTS. The recency order is kept per shard, every item carries a timestamp and every shard
+/// publishes the timestamps of its first/last item. get_first()/get_last() compare these without locking all
+/// shards, thus they are eventually consistent: a concurrent insert into another shard may or may not be seen.
+/// @tparam Key See MyHashTable.
+/// @tparam Value See MyHashTable. Values are returned by copy, since another thread may change them.
+/// @tparam Hash See MyHashTable.
+template <typename Key = std::string, typename Value = int, typename Hash = MyDjb2Hash>
+class MyConcurrentHashTable
+{
+public:
+    typedef typename MyKeyTraits<Key>::lookup_type lookup_type;
+    /// @brief Type of the keys returned by get_first()/get_last(): a copy of the key.
+    typedef typename std::conditional<MyKeyTraits<Key>::is_string, std::string, Key>::type key_type;
+
+private:
+    typedef MyHashTable<Key, MyStampedValue<Value>, Hash> ShardTable;
+
+    /// @brief A shard with its own lock, on its own cache lines.
+    struct alignas(MY_CACHE_LINE_SIZE) MyShard
+    {
+        std::shared_mutex lock;
+        // Odd while a writer changes the table, see get().
+        std::atomic<uint64_t> sequence{0};
+        ShardTable table;
+        // Reader slots that have not yet been seen without a reader since a slot table was retired.
+        std::bitset<MY_READER_SLOTS> retired_readers;
+        // Published by the writer for readers that don't lock the shard.
+        std::atomic<int64_t> first_stamp{MY_NO_STAMP};
+        std::atomic<int64_t> last_stamp{MY_NO_STAMP};
+        std::atomic<unsigned long> count{0};
+
+        MyShard(unsigned long size, bool growable) : table(size, growable) { this->table.set_retire_slot_tables(true); }
+    };
+
+    std::vector<std::unique_ptr<MyShard>> shards;
+    /// @brief shards.size() - 1, the number of shards is a power of 2.
+    unsigned long shard_mask;
+    /// @brief The hash policy.
+    Hash hasher;
+
+    /// @brief Get the shard of a key by its hash. Uses the upper half of the hash, the shard uses the hash modulo its size.
+    MyShard &shard_of_hash(uint64_t key_hash) { return *this->shards[(key_hash >> 32) & this->shard_mask]; }
+
+    /// @brief Get the shard of a key.
+    MyShard &shard_of(lookup_type key) { return shard_of_hash(my_hash_key<Key>(this->hasher, key)); }
+
+    /// @brief Change a shard: lock it, make its sequence number odd while change runs, then publish the new state.
+    template <typename Change>
+    void write(MyShard &shard, Change change)
+    {
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        size_t retired = shard.table.get_retired_slot_table_count();
+        shard.sequence.fetch_add(1);
+        change(shard.table);
+        shard.sequence.fetch_add(1);
+        publish(shard);
+        if (shard.table.get_retired_slot_table_count() > retired)
+        {
+            shard.retired_readers.set();
+        }
+        free_retired(shard);
+    }
+
+    /// @brief Free the retired slot tables of a shard once every reader slot has been seen without a reader after
+    /// they were retired: a reader that started later sees the new sequence number and thus the new slot tables.
+    void free_retired(MyShard &shard)
+    {
+        for (unsigned i = 0; i < MY_READER_SLOTS && shard.retired_readers.any(); i++)
+        {
+            if (shard.retired_readers[i] && !my_reader_slots()[i].reading.load())
+            {
+                shard.retired_readers.reset(i);
+            }
+        }
+        if (shard.retired_readers.none() && shard.table.get_retired_slot_table_count() != 0)
+        {
+            shard.table.free_retired_slot_tables();
+        }
+    }
+
+    /// @brief Get a copy of the value of a key without locking its shard, see the class description.
+    /// @param slot The reader slot of the calling thread.
+    /// @param found Set to true if the key was found (then value is set), or false.
+    /// @return False if writers kept changing the shard for MY_OPTIMISTIC_READ_ATTEMPTS attempts.
+    bool get_optimistic(MyShard &shard, MyReaderSlot &slot, lookup_type key, uint64_t key_hash, Value &value, bool &found)
+    {
+        // Flag the reader before the sequence number is read, a writer frees retired slot tables only after it has
+        // seen the slot without a reader. Only this thread writes the slot, a store suffices (no read-modify-write).
+        slot.reading.store(true);
+        for (unsigned attempt = 0; attempt < MY_OPTIMISTIC_READ_ATTEMPTS; attempt++)
+        {
+            uint64_t sequence = shard.sequence.load();
+            if ((sequence & 1) != 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            // The view is only used if no writer changed it while it was copied.
+            typename ShardTable::ReadView view = shard.table.get_read_view();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (shard.sequence.load(std::memory_order_relaxed) != sequence)
+            {
+                continue;
+            }
+            MyStampedValue<Value> stamped;
+            found = shard.table.get_in_view(view, key, key_hash, &stamped);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (shard.sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                slot.reading.store(false, std::memory_order_release);
+                if (found)
+                {
+                    value = stamped.value;
+                }
+                return true;
+            }
+        }
+        slot.reading.store(false, std::memory_order_release);
+        return false;
+    }
+
+    /// @brief Publish the state of a shard after a change, must be called while the shard is locked.
+    void publish(MyShard &shard)
+    {
+        typename ShardTable::Item *first = shard.table.get_first();
+        typename ShardTable::Item *last = shard.table.get_last();
+        shard.first_stamp.store(first == nullptr ? MY_NO_STAMP : first->value.stamp, std::memory_order_release);
+        shard.last_stamp.store(last == nullptr ? MY_NO_STAMP : last->value.stamp, std::memory_order_release);
+        shard.count.store(shard.table.get_count(), std::memory_order_release);
+    }
+
+    /// @brief Copy the key and value of the first or last item of a shard.
+    bool copy_item(MyShard &shard, bool last, key_type *key, Value *value)
+    {
+        std::shared_lock<std::shared_mutex> guard(shard.lock);
+        typename ShardTable::Item *item = last ? shard.table.get_last() : shard.table.get_first();
+        if (item == nullptr)
+        {
+            return false;
+        }
+        *key = key_type(shard.table.get_key(item));
+        *value = item->value.value;
+        return true;
+    }
+
+    /// @brief Find the shard with the oldest first item or the newest last item and copy that item.
+    bool find_extreme(bool last, key_type *key, Value *value)
+    {
+        // The stamps may change while they are compared, retry if the chosen shard became empty meanwhile.
+        for (;;)
+        {
+            MyShard *best = nullptr;
+            int64_t best_stamp = MY_NO_STAMP;
+            for (const std::unique_ptr<MyShard> &shard : this->shards)
+            {
+                int64_t stamp = (last ? shard->last_stamp : shard->first_stamp).load(std::memory_order_acquire);
+                if (stamp != MY_NO_STAMP && (best == nullptr || (last ? stamp > best_stamp : stamp < best_stamp)))
+                {
+                    best = shard.get();
+                    best_stamp = stamp;
+                }
+            }
+            if (best == nullptr)
+            {
+                return false;
+            }
+            if (copy_item(*best, last, key, value))
+            {
+                return true;
+            }
+        }
+    }
+
+public:
+    /// @brief Constructor
+    /// @param size Capacity, or initial capacity if growable. It is split over the shards.
+    /// @param growable True: every shard grows on its own, see MyHashTable. Recommended, because the keys
+    /// are not spread perfectly evenly over the shards.
+    /// @param shard_count Rounded up to a power of 2. 0: 4 shards per hardware thread.
+    MyConcurrentHashTable(unsigned long size, bool growable = true, unsigned long shard_count = 0)
+    {
+        if (shard_count == 0)
+        {
+            shard_count = 4 * (unsigned long)std::max(1u, std::thread::hardware_concurrency());
+        }
+        unsigned long count = 1;
+        while (count < shard_count)
+        {
+            count *= 2;
+        }
+        this->shard_mask = count - 1;
+        unsigned long shard_size = std::max(size / count, MY_GROUP_WIDTH);
+        for (unsigned long i = 0; i < count; i++)
+        {
+            this->shards.push_back(std::make_unique<MyShard>(shard_size, growable));
+        }
+    }
+
+    MyConcurrentHashTable(const MyConcurrentHashTable &) = delete;
+    MyConcurrentHashTable &operator=(const MyConcurrentHashTable &) = delete;
+
+    /// @brief Insert a key-value pair or update the key's existing value. Locks the key's shard.
+    /// @param key
+    /// @param value
+    void insert(lookup_type key, const Value &value)
+    {
+        write(shard_of(key), [&](ShardTable &table)
+              { table.insert(key, MyStampedValue<Value>{value, my_stamp_now()}); });
+    }
+
+    /// @brief Remove a key. Locks the key's shard.
+    /// @param key
+    void remove(lookup_type key)
+    {
+        write(shard_of(key), [&](ShardTable &table)
+              { table.remove(key); });
+    }
+
+    /// @brief Get a copy of the value of a key without locking, see above. Lock-free unless writers keep changing
+    /// the key's shard, then (and for values that are not trivially copyable) it takes the reader lock of the shard.
+    /// @param key
+    /// @param value Set if the key was found.
+    /// @return False if the key was not found.
+    bool get(lookup_type key, Value &value)
+    {
+        uint64_t key_hash = my_hash_key<Key>(this->hasher, key);
+        MyShard &shard = shard_of_hash(key_hash);
+        if constexpr (std::is_trivially_copyable<Value>::value)
+        {
+            MyReaderSlot *slot = my_reader_slot();
+            bool found;
+            if (slot != nullptr && get_optimistic(shard, *slot, key, key_hash, value, found))
+            {
+                return found;
+            }
+        }
+        return get_locked(key, value);
+    }
+
+    /// @brief Get a copy of the value of a key under the reader lock of its shard, blocks while a writer changes the
+    /// shard. The fallback of get(), e.g. to compare both in concurrent_bench.
+    /// @param key
+    /// @param value Set if the key was found.
+    /// @return False if the key was not found.
+    bool get_locked(lookup_type key, Value &value)
+    {
+        MyShard &shard = shard_of(key);
+        std::shared_lock<std::shared_mutex> guard(shard.lock);
+        MyStampedValue<Value> *stamped = shard.table.get(key);
+        if (stamped == nullptr)
+        {
+            return false;
+        }
+        value = stamped->value;
+        return true;
+    }
+
+    /// @brief Get the number of items, eventually consistent. O(number of shards) without locking.
+    unsigned long get_count()
+    {
+        unsigned long count = 0;
+        for (const std::unique_ptr<MyShard> &shard : this->shards)
+        {
+            count += shard->count.load(std::memory_order_acquire);
+        }
+        return count;
+    }
+
+    /// @brief Get the number of shards.
+    unsigned long get_shard_count() { return (unsigned long)this->shards.size(); }
+
+    /// @brief Get a copy of the most recently inserted/changed item, eventually consistent.
+    /// @details O(number of shards): compares the published stamps and only locks the shard of the result.
+    /// @param key
+    /// @param value
+    /// @return False if the hash table is empty.
+    bool get_last(key_type &key, Value &value) { return find_extreme(true, &key, &value); }
+
+    /// @brief Get a copy of the least recently inserted/changed item, eventually consistent. See get_last().
+    /// @param key
+    /// @param value
+    /// @return False if the hash table is empty.
+    bool get_first(key_type &key, Value &value) { return find_extreme(false, &key, &value); }
+};
+
+#endif
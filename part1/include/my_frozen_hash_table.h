@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "my_hash_table.h"
+
+#ifndef __MY_FROZEN_HASH_TABLE_H__
+#define __MY_FROZEN_HASH_TABLE_H__
+
+/// @brief Identifies a serialized MyFrozenHashTable ("MYFROZEN").
+const uint64_t MY_FROZEN_MAGIC = 0x4E455A4F5246594Dull;
+/// @brief Version of the serialized format, increase it whenever the format changes.
+const uint32_t MY_FROZEN_VERSION = 2;
+/// @brief Average number of keys per bucket of the perfect hash function.
+const uint32_t MY_FROZEN_BUCKET_SIZE = 4;
+/// @brief Number of pilots tried per bucket before the build is restarted with another seed.
+const uint32_t MY_FROZEN_MAX_PILOT = 1u << 20;
+/// @brief Number of seeds tried before the build fails (e.g. because two keys have the same hash).
+const uint32_t MY_FROZEN_MAX_SEEDS = 16;
+
+/// @brief Finalizer of splitmix64, mixes all bits of x.
+inline uint64_t my_mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/// @brief Header of a serialized MyFrozenHashTable, followed by the pilots, the items, the key arena and a trailer
+/// with the CRC-32C of all bytes before it (uint64_t).
+typedef struct MyFrozenHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t item_size; // sizeof(Item), to detect a different Key/Value type
+    uint64_t seed;
+    uint32_t count;
+    uint32_t bucket_count;
+    uint32_t first_index;
+    uint32_t last_index;
+    uint32_t key_arena_size;
+    uint32_t reserved;
+} MyFrozenHeader;
+
+/// @brief Read-only hash table for static key sets, built from a MyHashTable or a list of keys.
+/// @details Uses a minimal perfect hash function (hash and displace, like CHD/PTHash): the keys
+/// are split into buckets and every bucket gets a "pilot" such that all keys are mapped to
+/// distinct positions in [0, count). Thus there are no collisions and a lookup reads one pilot
+/// (small array, usually cached) and one item. The recency chain of the source table is kept,
+/// thus get_first()/get_last() return the same items.
+/// @tparam Key See MyHashTable.
+/// @tparam Value See MyHashTable. Must be trivially copyable for save()/load().
+/// @tparam Hash See MyHashTable.
+template <typename Key = std::string, typename Value = int, typename Hash = MyDjb2Hash>
+class MyFrozenHashTable
+{
+public:
+    typedef MyItem<Key, Value> Item;
+    typedef typename MyKeyTraits<Key>::lookup_type lookup_type;
+
+private:
+    /// @brief Item of every key at the position of the perfect hash function.
+    std::vector<Item> items;
+    /// @brief Pilot per bucket.
+    std::vector<uint32_t> pilots;
+    /// @brief String keys that are too long to be stored inline.
+    std::vector<char> key_arena;
+    /// @brief Seed of the perfect hash function.
+    uint64_t seed = 0;
+    /// @brief Index of the most recently inserted/changed item.
+    uint32_t last_index = MY_NO_INDEX;
+    /// @brief Index of the least recently inserted/changed item.
+    uint32_t first_index = MY_NO_INDEX;
+    /// @brief The hash policy.
+    Hash hasher;
+
+    /// @brief Get the bucket of a hash.
+    uint32_t bucket_of(uint64_t key_hash) { return (uint32_t)(my_mix64(key_hash + this->seed) % this->pilots.size()); }
+
+    /// @brief Get the position of a hash for the pilot of its bucket.
+    uint32_t position_of(uint64_t key_hash, uint32_t pilot)
+    {
+        return (uint32_t)(my_mix64(key_hash ^ (this->seed + pilot * 0x9E3779B97F4A7C15ull)) % this->items.size());
+    }
+
+    /// @brief Find a pilot for every bucket with the current seed.
+    /// @param hashes Hash of every key.
+    /// @param positions Set to the position of every key.
+    /// @return False if no pilot was found for a bucket.
+    bool find_pilots(const std::vector<uint64_t> &hashes, std::vector<uint32_t> &positions)
+    {
+        uint32_t count = (uint32_t)hashes.size();
+        uint32_t bucket_count = (uint32_t)this->pilots.size();
+
+        // Sort the keys by bucket, the largest buckets get their pilots first.
+        std::vector<uint32_t> buckets(count);
+        std::vector<uint32_t> bucket_sizes(bucket_count, 0);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            buckets[i] = bucket_of(hashes[i]);
+            bucket_sizes[buckets[i]]++;
+        }
+        std::vector<uint32_t> keys(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            keys[i] = i;
+        }
+        std::sort(keys.begin(), keys.end(), [&](uint32_t a, uint32_t b)
+                  { return bucket_sizes[buckets[a]] != bucket_sizes[buckets[b]] ? bucket_sizes[buckets[a]] > bucket_sizes[buckets[b]]
+                                                                                : buckets[a] < buckets[b]; });
+
+        std::vector<bool> taken(count, false);
+        std::vector<uint32_t> bucket_positions;
+        for (uint32_t start = 0; start < count;)
+        {
+            uint32_t bucket = buckets[keys[start]];
+            uint32_t end = start + bucket_sizes[bucket];
+            uint32_t pilot = 0;
+            for (; pilot < MY_FROZEN_MAX_PILOT; pilot++)
+            {
+                bucket_positions.clear();
+                bool found = true;
+                for (uint32_t i = start; i < end && found; i++)
+                {
+                    uint32_t position = position_of(hashes[keys[i]], pilot);
+                    found = !taken[position] && std::find(bucket_positions.begin(), bucket_positions.end(), position) == bucket_positions.end();
+                    bucket_positions.push_back(position);
+                }
+                if (found)
+                {
+                    break;
+                }
+            }
+            if (pilot == MY_FROZEN_MAX_PILOT)
+            {
+                return false;
+            }
+            this->pilots[bucket] = pilot;
+            for (uint32_t i = start; i < end; i++)
+            {
+                positions[keys[i]] = bucket_positions[i - start];
+                taken[bucket_positions[i - start]] = true;
+            }
+            start = end;
+        }
+        return true;
+    }
+
+    /// @brief Check the indexes and key offsets of loaded items, see load().
+    bool check(const MyFrozenHeader &header)
+    {
+        uint32_t count = (uint32_t)this->items.size();
+        if (count == 0)
+        {
+            return header.first_index == MY_NO_INDEX && header.last_index == MY_NO_INDEX;
+        }
+        if (header.first_index >= count || header.last_index >= count)
+        {
+            return false;
+        }
+        for (const Item &item : this->items)
+        {
+            if ((item.next_index != MY_NO_INDEX && item.next_index >= count) ||
+                (item.prev_index != MY_NO_INDEX && item.prev_index >= count))
+            {
+                return false;
+            }
+            if constexpr (MyKeyTraits<Key>::is_string)
+            {
+                if (item.key.length > MY_INLINE_KEY_LENGTH && (uint64_t)item.key.offset + item.key.length >= this->key_arena.size())
+                {
+                    return false;
+                }
+            }
+        }
+        // The chain must visit every item once, thus traversing it ends.
+        uint32_t visited = 0;
+        uint32_t prev = MY_NO_INDEX;
+        for (uint32_t i = header.first_index; i != MY_NO_INDEX && visited < count; i = this->items[i].next_index)
+        {
+            if (this->items[i].prev_index != prev)
+            {
+                return false;
+            }
+            prev = i;
+            visited++;
+        }
+        return visited == count && prev == header.last_index && this->items[prev].next_index == MY_NO_INDEX;
+    }
+
+public:
+    /// @brief Build the perfect hash table from all items of a hash table.
+    /// @param table Source, is not changed.
+    /// @return False if the build failed, e.g. because two keys have the same 64-bit hash.
+    bool build(MyHashTable<Key, Value, Hash> &table)
+    {
+        // Collect the items in recency order, index i becomes the i-th item of the chain.
+        std::vector<Item *> source;
+        source.reserve(table.get_count());
+        for (Item *item = table.get_first(); item != nullptr; item = table.get_next(item))
+        {
+            source.push_back(item);
+        }
+        uint32_t count = (uint32_t)source.size();
+        std::vector<uint64_t> hashes(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            hashes[i] = my_hash_key<Key>(this->hasher, table.get_key(source[i]));
+        }
+
+        this->items.assign(count, Item());
+        this->pilots.assign(count / MY_FROZEN_BUCKET_SIZE + 1, 0);
+        this->key_arena.clear();
+        this->first_index = this->last_index = MY_NO_INDEX;
+        std::vector<uint32_t> positions(count);
+        bool found = false;
+        for (uint32_t attempt = 0; attempt < MY_FROZEN_MAX_SEEDS && !found; attempt++)
+        {
+            this->seed = my_mix64(attempt + 1);
+            found = count == 0 || find_pilots(hashes, positions);
+        }
+        if (!found)
+        {
+            this->items.clear();
+            this->pilots.clear();
+            return false;
+        }
+
+        // Copy the items to their positions and link them in the same order.
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Item *item = &this->items[positions[i]];
+            item->value = source[i]->value;
+            item->prev_index = i == 0 ? MY_NO_INDEX : positions[i - 1];
+            item->next_index = i + 1 == count ? MY_NO_INDEX : positions[i + 1];
+            item->key = source[i]->key;
+            if constexpr (MyKeyTraits<Key>::is_string)
+            {
+                if (item->key.length > MY_INLINE_KEY_LENGTH)
+                {
+                    lookup_type key = table.get_key(source[i]);
+                    item->key.offset = (uint32_t)this->key_arena.size();
+                    this->key_arena.insert(this->key_arena.end(), key.begin(), key.end());
+                    this->key_arena.push_back('\0');
+                }
+            }
+        }
+        if (count > 0)
+        {
+            this->first_index = positions[0];
+            this->last_index = positions[count - 1];
+        }
+        return true;
+    }
+
+    /// @brief Build the perfect hash table from a list of keys and their values.
+    /// @details Duplicate keys keep the last value, like MyHashTable::insert().
+    /// @param keys
+    /// @param values Same length as keys.
+    /// @return False if the build failed, see build(MyHashTable).
+    bool build(const std::vector<lookup_type> &keys, const std::vector<Value> &values)
+    {
+        MyHashTable<Key, Value, Hash> table(keys.size() + keys.size() / 4 + 1);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            table.insert(keys[i], values[i]);
+        }
+        return build(table);
+    }
+
+    /// @brief Write the hash table to a binary stream, e.g. a std::ofstream opened with std::ios::binary.
+    /// @param out
+    /// @return False if writing failed.
+    bool save(std::ostream &out)
+    {
+        static_assert(std::is_trivially_copyable<Item>::value, "Value must be trivially copyable to be saved");
+        MyFrozenHeader header = {MY_FROZEN_MAGIC, MY_FROZEN_VERSION, (uint32_t)sizeof(Item), this->seed,
+                                 (uint32_t)this->items.size(), (uint32_t)this->pilots.size(),
+                                 this->first_index, this->last_index, (uint32_t)this->key_arena.size(), 0};
+        uint32_t checksum = 0;
+        auto write = [&](const void *data, size_t size)
+        {
+            checksum = my_crc32c((const char *)data, size, checksum);
+            out.write((const char *)data, size);
+        };
+        write(&header, sizeof(header));
+        write(this->pilots.data(), this->pilots.size() * sizeof(uint32_t));
+        write(this->items.data(), this->items.size() * sizeof(Item));
+        write(this->key_arena.data(), this->key_arena.size());
+        uint64_t trailer = checksum;
+        out.write((const char *)&trailer, sizeof(trailer));
+        return out.good();
+    }
+
+    /// @brief Read a hash table written by save(). The key, value and hash types must be the same.
+    /// @details Nothing of the file is trusted: the sections are read in blocks, thus a header with a wrong count
+    /// cannot allocate more memory than the stream holds, the checksum must match and every index and key offset
+    /// must be within the table, the recency chain must link all items once.
+    /// @param in
+    /// @return False if the stream does not contain a compatible hash table or is incomplete or corrupt, the table
+    /// is empty then.
+    bool load(std::istream &in)
+    {
+        static_assert(std::is_trivially_copyable<Item>::value, "Value must be trivially copyable to be loaded");
+        this->items.clear();
+        this->pilots.clear();
+        this->key_arena.clear();
+        this->first_index = this->last_index = MY_NO_INDEX;
+        uint32_t checksum = 0;
+        auto read = [&](auto &section, size_t size)
+        {
+            const size_t block_size = 4096;
+            for (size_t done = 0; done < size && in.good(); done += block_size)
+            {
+                size_t start = section.size();
+                section.resize(start + std::min(block_size, size - done));
+                in.read((char *)(section.data() + start), (section.size() - start) * sizeof(section[0]));
+                checksum = my_crc32c((const char *)(section.data() + start), (section.size() - start) * sizeof(section[0]), checksum);
+            }
+        };
+        MyFrozenHeader header;
+        in.read((char *)&header, sizeof(header));
+        checksum = my_crc32c((const char *)&header, sizeof(header), checksum);
+        bool ok = in.good() && header.magic == MY_FROZEN_MAGIC && header.version == MY_FROZEN_VERSION &&
+                  header.item_size == sizeof(Item) && header.count < MY_NO_INDEX &&
+                  header.bucket_count == header.count / MY_FROZEN_BUCKET_SIZE + 1;
+        if (ok)
+        {
+            read(this->pilots, header.bucket_count);
+            read(this->items, header.count);
+            read(this->key_arena, header.key_arena_size);
+            uint64_t trailer = 0;
+            in.read((char *)&trailer, sizeof(trailer));
+            ok = in.good() && trailer == checksum && check(header);
+        }
+        if (!ok)
+        {
+            this->items.clear();
+            this->pilots.clear();
+            this->key_arena.clear();
+            this->first_index = this->last_index = MY_NO_INDEX;
+            return false;
+        }
+        this->seed = header.seed;
+        this->first_index = header.first_index;
+        this->last_index = header.last_index;
+        return true;
+    }
+
+    /// @brief Get the key of an item, see MyHashTable::get_key().
+    /// @param item
+    /// @return
+    lookup_type get_key(const Item *item)
+    {
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            const char *key = item->key.length <= MY_INLINE_KEY_LENGTH ? item->key.inline_key : this->key_arena.data() + item->key.offset;
+            return std::string_view(key, item->key.length);
+        }
+        else
+        {
+            return item->key;
+        }
+    }
+
+    /// @brief Get the value of the corresponding key. O(1), without probing.
+    /// @param key
+    /// @return nullptr if the key is not part of the hash table.
+    const Value *get(lookup_type key)
+    {
+        if (this->items.empty())
+        {
+            return nullptr;
+        }
+        uint64_t key_hash = my_hash_key<Key>(this->hasher, key);
+        Item *item = &this->items[position_of(key_hash, this->pilots[bucket_of(key_hash)])];
+        // Keys that are not part of the hash table are mapped to an arbitrary item.
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            if (item->key.length != key.size() || memcmp(get_key(item).data(), key.data(), key.size()) != 0)
+            {
+                return nullptr;
+            }
+        }
+        else
+        {
+            if (!(item->key == key))
+            {
+                return nullptr;
+            }
+        }
+        return &item->value;
+    }
+
+    /// @brief Get the number of items.
+    unsigned long get_count() { return (unsigned long)this->items.size(); }
+
+    /// @brief Get the size of the hash table in bytes (items, pilots and key arena).
+    size_t get_memory() { return this->items.size() * sizeof(Item) + this->pilots.size() * sizeof(uint32_t) + this->key_arena.size(); }
+
+    /// @brief Get the most recently inserted/changed item of the source table.
+    const Item *get_last() { return this->last_index == MY_NO_INDEX ? nullptr : &this->items[this->last_index]; } // O(1)
+
+    /// @brief Get the least recently inserted/changed item of the source table.
+    const Item *get_first() { return this->first_index == MY_NO_INDEX ? nullptr : &this->items[this->first_index]; } // O(1)
+
+    /// @brief Get the item after the given item in recency order.
+    const Item *get_next(const Item *item) { return item->next_index == MY_NO_INDEX ? nullptr : &this->items[item->next_index]; } // O(1)
+
+    /// @brief Get the item before the given item in recency order.
+    const Item *get_prev(const Item *item) { return item->prev_index == MY_NO_INDEX ? nullptr : &this->items[item->prev_index]; } // O(1)
+};
+
+#endif
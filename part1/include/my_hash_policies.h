@@ -0,0 +1,201 @@
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#if defined(__SSE4_2__) || defined(__AVX2__)
+#include <nmmintrin.h>
+#define MY_CRC32_SSE42
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define MY_CRC32_ARM
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+#ifndef __MY_HASH_POLICIES_H__
+#define __MY_HASH_POLICIES_H__
+
+// -----------------------------------------------------------
+// Hash policies for MyHashTable: functors that hash the bytes of a key to 64 bits.
+// The hash table uses the hash modulo its size as index and the 7 highest bits as tag,
+// thus every policy must spread the key over the high bits.
+// -----------------------------------------------------------
+
+/// @brief Read 8 bytes of unaligned memory.
+inline uint64_t my_read64(const char *data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/// @brief Read 4 bytes of unaligned memory.
+inline uint64_t my_read32(const char *data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/// @brief Multiply two 64-bit values to 128 bits and fold the result to 64 bits.
+inline uint64_t my_mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t result = (__uint128_t)a * b;
+    return (uint64_t)result ^ (uint64_t)(result >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t high;
+    uint64_t low = _umul128(a, b, &high);
+    return low ^ high;
+#else
+    uint64_t a_low = (uint32_t)a, a_high = a >> 32, b_low = (uint32_t)b, b_high = b >> 32;
+    uint64_t low_low = a_low * b_low, low_high = a_low * b_high, high_low = a_high * b_low, high_high = a_high * b_high;
+    uint64_t middle = (low_low >> 32) + (uint32_t)low_high + (uint32_t)high_low;
+    uint64_t low = (middle << 32) | (uint32_t)low_low;
+    uint64_t high = high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32);
+    return low ^ high;
+#endif
+}
+
+/// @brief djb2 hash, source: http://www.cse.yorku.ca/%7Eoz/hash.html
+/// @details The result is multiplied by the 64-bit golden ratio to spread djb2's bits over the tag.
+struct MyDjb2Hash
+{
+    uint64_t operator()(const char *data, size_t length) const
+    {
+        uint64_t hash = 5381;
+        for (size_t i = 0; i < length; i++)
+        {
+            hash = ((hash << 5) + hash) + (unsigned char)data[i]; /* hash * 33 + c */
+        }
+        return hash * 0x9E3779B97F4A7C15ull;
+    }
+};
+
+/// @brief 64-bit FNV-1a hash, source: http://www.isthe.com/chongo/tech/comp/fnv/
+struct MyFnv1aHash
+{
+    uint64_t operator()(const char *data, size_t length) const
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+};
+
+/// @brief Hash in the style of wyhash (https://github.com/wangyi-fudan/wyhash): reads 8/16 bytes
+/// at a time and mixes them with 64x64->128 bit multiplications. Short keys need no loop at all.
+/// @details Not compatible with the original wyhash output.
+struct MyWyHash
+{
+    uint64_t operator()(const char *data, size_t length) const
+    {
+        const uint64_t secret0 = 0xa0761d6478bd642full;
+        const uint64_t secret1 = 0xe7037ed1a0b428dbull;
+        const uint64_t secret2 = 0x8ebc6af09c88c6e3ull;
+        uint64_t seed = secret0;
+        uint64_t a, b;
+        size_t n = length;
+        while (n > 16)
+        {
+            seed = my_mum(my_read64(data) ^ secret1, my_read64(data + 8) ^ seed);
+            data += 16;
+            n -= 16;
+        }
+        if (n >= 8)
+        {
+            a = my_read64(data);
+            b = my_read64(data + n - 8);
+        }
+        else if (n >= 4)
+        {
+            a = my_read32(data);
+            b = my_read32(data + n - 4);
+        }
+        else if (n > 0)
+        {
+            a = ((uint64_t)(unsigned char)data[0] << 16) | ((uint64_t)(unsigned char)data[n >> 1] << 8) | (unsigned char)data[n - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+        return my_mum(secret2 ^ length, my_mum(a ^ secret1, b ^ seed));
+    }
+};
+
+/// @brief CRC-32C table for MyCrc32Hash if the CPU instruction is not available.
+struct MyCrc32Table
+{
+    uint32_t values[256];
+    constexpr MyCrc32Table() : values()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+            }
+            values[i] = crc;
+        }
+    }
+};
+
+/// @brief CRC-32C of data using the CPU instruction (SSE4.2 or ARMv8 CRC32, 8 bytes per instruction).
+/// Falls back to a table if the instruction is not available, see ENABLE_SSE42 in CMakeLists.txt.
+/// @param data
+/// @param length
+/// @param crc CRC-32C of the preceding data, to compute the CRC of data that is split into several parts.
+/// @return
+inline uint32_t my_crc32c(const char *data, size_t length, uint32_t crc = 0)
+{
+    crc = ~crc;
+#if defined(MY_CRC32_SSE42)
+#if defined(__x86_64__) || defined(_M_X64)
+    for (; length >= 8; data += 8, length -= 8)
+    {
+        crc = (uint32_t)_mm_crc32_u64(crc, my_read64(data));
+    }
+#endif
+    for (; length > 0; data++, length--)
+    {
+        crc = _mm_crc32_u8(crc, (unsigned char)*data);
+    }
+#elif defined(MY_CRC32_ARM)
+    for (; length >= 8; data += 8, length -= 8)
+    {
+        crc = __crc32cd(crc, my_read64(data));
+    }
+    for (; length > 0; data++, length--)
+    {
+        crc = __crc32cb(crc, (unsigned char)*data);
+    }
+#else
+    static constexpr MyCrc32Table table;
+    for (; length > 0; data++, length--)
+    {
+        crc = table.values[(crc ^ (unsigned char)*data) & 0xFF] ^ (crc >> 8);
+    }
+#endif
+    return ~crc;
+}
+
+/// @brief CRC-32C hash, see my_crc32c().
+/// @details The 32-bit CRC is multiplied by the 64-bit golden ratio to spread it over the tag.
+struct MyCrc32Hash
+{
+    uint64_t operator()(const char *data, size_t length) const
+    {
+        return (uint64_t)my_crc32c(data, length) * 0x9E3779B97F4A7C15ull;
+    }
+};
+
+#endif
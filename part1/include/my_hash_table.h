@@ -1,51 +1,1910 @@
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "my_hash_policies.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MY_GROUP_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MY_GROUP_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #ifndef __MY_HASH_TABLE_H__
 #define __MY_HASH_TABLE_H__
 
+/// @brief Index used for "no item", e.g. the end of the recency chain.
+const uint32_t MY_NO_INDEX = UINT32_MAX;
+/// @brief String keys with up to this many characters (without '\0') are stored inside the item.
+const uint32_t MY_INLINE_KEY_LENGTH = 15;
+
+/// @brief Control byte of an empty slot. Full slots store the 7-bit tag of their hash (0x00..0x7F).
+const int8_t MY_CTRL_EMPTY = -128; // 0b10000000
+/// @brief Control byte of a removed slot (tombstone), probing must continue past it.
+const int8_t MY_CTRL_DELETED = -2; // 0b11111110
+/// @brief Items and long keys are stored in up to this many segments, each twice as large as the previous one.
+const uint32_t MY_SEGMENT_COUNT = 32;
+
+/// @brief A growable hash table grows when more than 7/8 of its slots are used.
+const unsigned long MY_MAX_LOAD_NUMERATOR = 7;
+const unsigned long MY_MAX_LOAD_DENOMINATOR = 8;
+/// @brief Number of old slots migrated by every insert/remove while the hash table grows.
+/// Must be at least 2, so that the migration is done before the new slots are full.
+const unsigned long MY_REHASH_STEP = 32;
+/// @brief The slots are compacted (rehashed without tombstones) when more than 1/4 are tombstones.
+const unsigned long MY_MAX_TOMBSTONE_DENOMINATOR = 4;
+/// @brief Number of items in the first items segment.
+const uint32_t MY_ITEMS_SEGMENT_SIZE = 64;
+/// @brief Number of bytes in the first key segment.
+const uint32_t MY_KEY_SEGMENT_SIZE = 1024;
+/// @brief Number of keys that are hashed and prefetched together by insert_batch() and get_batch().
+const size_t MY_BATCH_SIZE = 16;
+/// @brief The key arena is compacted when more than 1/2 of its bytes belong to removed keys.
+const uint32_t MY_MAX_KEY_GARBAGE_DENOMINATOR = 2;
+
+// -----------------------------------------------------------
+// Group probing: compare the control bytes of several slots at once.
+// -----------------------------------------------------------
+
+#if defined(MY_GROUP_AVX2)
+const unsigned long MY_GROUP_WIDTH = 32;
+#else
+const unsigned long MY_GROUP_WIDTH = 16;
+#endif
+
+/// @brief Bitmask with one bit per slot of a group (bit i = slot index + i).
+typedef uint32_t MyGroupMask;
+
+/// @brief Index of the lowest set bit, mask must not be 0.
+inline unsigned int my_lowest_bit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/// @brief Index of the highest set bit, value must not be 0.
+inline unsigned int my_highest_bit(uint32_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, value);
+    return index;
+#else
+    return 31 - __builtin_clz(value);
+#endif
+}
+
+/// @brief Number of consecutive slots at the end of the group that are not in the mask.
+inline unsigned int my_trailing_slots(MyGroupMask mask)
+{
+    if (mask == 0)
+    {
+        return MY_GROUP_WIDTH;
+    }
+    return MY_GROUP_WIDTH - 1 - my_highest_bit(mask);
+}
+
+/// @brief Load the cache line of an address in the background.
+inline void my_prefetch(const void *address)
+{
+#if defined(MY_GROUP_SSE2) || defined(MY_GROUP_AVX2)
+    _mm_prefetch((const char *)address, _MM_HINT_T0);
+#elif defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+/// @brief Get the slots of the group starting at ctrl whose control byte equals value.
+/// @param ctrl Control byte of the first slot of the group.
+/// @param value Tag, MY_CTRL_EMPTY or MY_CTRL_DELETED.
+/// @return
+inline MyGroupMask my_group_match(const int8_t *ctrl, int8_t value)
+{
+#if defined(MY_GROUP_AVX2)
+    __m256i group = _mm256_loadu_si256((const __m256i *)ctrl);
+    return (MyGroupMask)_mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8(value)));
+#elif defined(MY_GROUP_SSE2)
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (MyGroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+    MyGroupMask mask = 0;
+    for (unsigned long i = 0; i < MY_GROUP_WIDTH; i++)
+    {
+        mask |= (MyGroupMask)(ctrl[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+/// @brief Get the slots of the group starting at ctrl that are empty or deleted (sign bit set).
+/// @param ctrl Control byte of the first slot of the group.
+/// @return
+inline MyGroupMask my_group_match_available(const int8_t *ctrl)
+{
+#if defined(MY_GROUP_AVX2)
+    return (MyGroupMask)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)ctrl));
+#elif defined(MY_GROUP_SSE2)
+    return (MyGroupMask)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    MyGroupMask mask = 0;
+    for (unsigned long i = 0; i < MY_GROUP_WIDTH; i++)
+    {
+        mask |= (MyGroupMask)(ctrl[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+// -----------------------------------------------------------
+// Segmented storage of the items and long keys.
+// -----------------------------------------------------------
+
+/// @brief Storage where segment i holds FirstSize * 2^i elements. Segments are allocated when
+/// needed and elements never move, thus indexes and pointers to elements stay valid.
+/// @details Elements are not constructed, the owner is responsible for that.
+template <typename T, uint32_t FirstSize>
+class MySegments
+{
+private:
+    T *segments[MY_SEGMENT_COUNT];
+    /// @brief Number of elements of all allocated segments.
+    uint32_t capacity;
+
+public:
+    MySegments() : segments(), capacity(0) {}
+    MySegments(const MySegments &) = delete;
+    MySegments &operator=(const MySegments &) = delete;
+    ~MySegments()
+    {
+        for (uint32_t i = 0; i < MY_SEGMENT_COUNT; i++)
+        {
+            free(this->segments[i]);
+        }
+    }
+
+    /// @brief Locate an element.
+    /// @param index Index of the element over all segments.
+    /// @param offset Set to the index within the segment.
+    /// @return Segment index.
+    static uint32_t locate(uint32_t index, uint32_t *offset)
+    {
+        uint32_t segment = my_highest_bit(index / FirstSize + 1);
+        *offset = (uint32_t)(index - (uint64_t)FirstSize * ((1ull << segment) - 1));
+        return segment;
+    }
+
+    /// @brief Number of elements in the segment.
+    static uint32_t segment_size(uint32_t segment) { return FirstSize << segment; }
+
+    /// @brief Allocate the segment if it does not yet exist. Throws std::bad_alloc if that fails.
+    void allocate(uint32_t segment)
+    {
+        if (this->segments[segment] == nullptr)
+        {
+            this->segments[segment] = (T *)malloc((size_t)segment_size(segment) * sizeof(T));
+            if (this->segments[segment] == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            this->capacity += segment_size(segment);
+        }
+    }
+
+    /// @brief Get the element at the index, its segment must be allocated.
+    T *at(uint32_t index)
+    {
+        uint32_t offset;
+        uint32_t segment = locate(index, &offset);
+        return this->segments[segment] + offset;
+    }
+
+    /// @brief Get the element at the offset of a segment.
+    T *at(uint32_t segment, uint32_t offset) { return this->segments[segment] + offset; }
+
+    /// @brief Get a segment, nullptr if it is not allocated.
+    T *get_segment(uint32_t segment) { return this->segments[segment]; }
+
+    uint32_t get_capacity() { return this->capacity; }
+};
+
+/// @brief Storage of all string keys that are too long to be stored inline, referenced by offset.
+/// @details A key is never split across two segments, the rest of a segment is skipped if needed.
+class MyKeyArena
+{
+private:
+    MySegments<char, MY_KEY_SEGMENT_SIZE> segments;
+    /// @brief Used bytes of the key arena (offset of the next key).
+    uint32_t size = 0;
+
+public:
+    /// @brief Copy the key (with a terminating '\0') into the arena.
+    /// @return Offset of the key.
+    uint32_t store(const char *key, uint32_t key_length)
+    {
+        uint32_t offset;
+        uint32_t segment = this->segments.locate(this->size, &offset);
+        while (offset + key_length + 1 > this->segments.segment_size(segment))
+        {
+            this->size += this->segments.segment_size(segment) - offset;
+            segment++;
+            offset = 0;
+        }
+        this->segments.allocate(segment);
+        char *destination = this->segments.at(segment, offset);
+        memcpy(destination, key, key_length);
+        destination[key_length] = '\0';
+        uint32_t key_offset = this->size;
+        this->size += key_length + 1;
+        return key_offset;
+    }
+
+    /// @brief Get the key stored at the offset.
+    const char *at(uint32_t key_offset) { return this->segments.at(key_offset); }
+
+    /// @brief Get the key stored at the offset if the key lies within an allocated segment, for readers that may
+    /// see an offset and length while they are changed.
+    /// @return nullptr if the key would not fit into its segment or the segment is not allocated.
+    const char *find(uint32_t key_offset, uint32_t key_length)
+    {
+        uint32_t offset;
+        uint32_t segment = this->segments.locate(key_offset, &offset);
+        if (segment >= MY_SEGMENT_COUNT || (uint64_t)offset + key_length >= this->segments.segment_size(segment) ||
+            this->segments.get_segment(segment) == nullptr)
+        {
+            return nullptr;
+        }
+        return this->segments.get_segment(segment) + offset;
+    }
+
+    /// @brief Remove all keys, the segments are kept and reused.
+    void clear() { this->size = 0; }
+
+    uint32_t get_size() { return this->size; }
+    uint32_t get_capacity() { return this->segments.get_capacity(); }
+};
+
+// -----------------------------------------------------------
+// Keys: strings are stored as MyStringKey, all other keys by value.
+// -----------------------------------------------------------
+
+/// @brief String key stored in an item: short keys inline, longer keys in the key arena.
+typedef struct MyStringKey
+{
+    uint32_t length;
+    union
+    {
+        char inline_key[MY_INLINE_KEY_LENGTH + 1]; // length <= MY_INLINE_KEY_LENGTH
+        uint32_t offset;                           // offset into the key arena otherwise
+    };
+} MyStringKey;
+
+/// @brief Describes how a key type is stored and looked up: by value for trivially copyable types.
+/// @details The bytes of the key are hashed, thus the type must not contain padding.
+template <typename Key>
+struct MyKeyTraits
+{
+    static_assert(std::has_unique_object_representations<Key>::value,
+                  "Keys must be strings or trivially copyable types without padding");
+    static const bool is_string = false;
+    /// @brief Type used by insert/get/remove.
+    typedef Key lookup_type;
+    /// @brief Type stored in the item.
+    typedef Key stored_type;
+};
+
+/// @brief String keys are looked up by std::string_view, so that no copy of the key is needed.
+struct MyStringKeyTraits
+{
+    static const bool is_string = true;
+    typedef std::string_view lookup_type;
+    typedef MyStringKey stored_type;
+};
+
+template <>
+struct MyKeyTraits<std::string> : MyStringKeyTraits
+{
+};
+template <>
+struct MyKeyTraits<std::string_view> : MyStringKeyTraits
+{
+};
+template <>
+struct MyKeyTraits<const char *> : MyStringKeyTraits
+{
+};
+template <>
+struct MyKeyTraits<char *> : MyStringKeyTraits
+{
+};
+
+/// @brief Hash a key with a hash policy: the characters of string keys, the bytes of other keys.
+template <typename Key, typename Hash>
+inline uint64_t my_hash_key(const Hash &hasher, typename MyKeyTraits<Key>::lookup_type key)
+{
+    if constexpr (MyKeyTraits<Key>::is_string)
+    {
+        return hasher(key.data(), key.size());
+    }
+    else
+    {
+        return hasher((const char *)&key, sizeof(key));
+    }
+}
+
 /// @brief Hash table entry
-typedef struct MyItem
+/// @details Items are stored by value in contiguous segments. Short string keys are stored inline,
+/// longer string keys are stored in the key arena of the hash table and referenced by offset.
+template <typename Key, typename Value>
+struct MyItem
+{
+    Value value;
+
+    // To keep track of the insertion/modifaction order of items (indexes into the items).
+    uint32_t prev_index; // previous item
+    uint32_t next_index; // successor item
+
+    typename MyKeyTraits<Key>::stored_type key;
+};
+
+/// @brief Slots used for linear probing. A growing or compacting hash table uses two of them
+/// while the items are migrated from the old to the new slots.
+typedef struct MySlotTable
+{
+    /// @brief Control byte per slot (tag, empty or deleted), followed by a copy of the first
+    /// group so that a group can be loaded at every slot index without wrapping around.
+    int8_t *ctrl;
+    /// @brief Item index per slot, only valid if the slot's control byte is a tag.
+    uint32_t *slots;
+    /// @brief Number of slots.
+    unsigned long size;
+} MySlotTable;
+
+/// @brief Number of buckets of the probe length histogram, the last bucket also counts all longer probes.
+const unsigned long MY_PROBE_HISTOGRAM_SIZE = 8;
+
+/// @brief Statistics of a hash table, see MyHashTable::get_stats().
+typedef struct MyHashTableStats
 {
-    char *key;
-    int *value;
+    /// @brief Number of items.
+    unsigned long count;
+    /// @brief Number of slots (new slots while migrating).
+    unsigned long size;
+    unsigned long tombstone_count;
+    /// @brief Used slots (items and tombstones) per slot.
+    double load_factor;
+    /// @brief Bytes allocated for control bytes, slots, items and key arena.
+    size_t memory;
+    /// @brief probe_histogram[i]: number of items that are found in the (i + 1)-th group of their probe sequence.
+    unsigned long probe_histogram[MY_PROBE_HISTOGRAM_SIZE];
+    /// @brief Distance in slots from the home slot (hash modulo size) of an item to its slot.
+    unsigned long max_displacement;
+    double mean_displacement;
+    /// @brief How evenly the hashes are spread over the home slots: about 1 for a uniformly random hash
+    /// function, larger values mean more items share a home slot. Sum of b(b+1)/2 over the number b of items
+    /// per home slot, divided by its expected value for a uniform distribution (Red Dragon Book).
+    double distribution_quality;
+    unsigned long collision_count;
+    unsigned long missed_count;
+} MyHashTableStats;
 
-    // To keep track of the insertion/modifaction order of items.
-    MyItem *prev_item; // previous item
-    MyItem *next_item; // successor item
-} MyItem;
+// -----------------------------------------------------------
+// Snapshots: binary image of a hash table that can be loaded without rehashing or memory-mapped.
+// -----------------------------------------------------------
 
+/// @brief Identifies a snapshot file ("MYSNAPSH").
+const uint64_t MY_SNAPSHOT_MAGIC = 0x4853504E53594Dull;
+/// @brief Version of the snapshot format, increase it whenever the format changes.
+const uint32_t MY_SNAPSHOT_VERSION = 1;
+/// @brief Sections of a snapshot start at multiples of this, so that they can be used in place when memory-mapped.
+const uint64_t MY_SNAPSHOT_ALIGNMENT = 64;
+/// @brief Key hashed with the hash policy to detect snapshots written with another policy.
+const char MY_SNAPSHOT_HASH_CHECK[] = "MyHashTable snapshot";
+/// @brief Upper bound of every size and offset in a snapshot header (256 TiB), so that their sums cannot overflow.
+const uint64_t MY_SNAPSHOT_MAX_SIZE = (uint64_t)1 << 48;
+
+/// @brief Header of a snapshot, followed by the sections at the given offsets.
+/// @details All references are indexes or offsets, thus a snapshot is position-independent:
+/// - ctrl: slot_count + group_width control bytes (with the copy of the first group)
+/// - slots: slot_count item indexes
+/// - items: count items in recency order (first to last)
+/// - key arena: long string keys, each terminated by '\0'
+/// - trailer: CRC-32C of all bytes before it (uint64_t)
+typedef struct MySnapshotHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t group_width; // probing depends on the group width (16 with SSE2, 32 with AVX2)
+    uint32_t item_size;
+    uint32_t key_is_string;
+    uint64_t hash_check;
+    uint64_t slot_count;
+    uint64_t count;
+    uint64_t ctrl_offset;
+    uint64_t slots_offset;
+    uint64_t items_offset;
+    uint64_t key_arena_offset;
+    uint64_t key_arena_size;
+    uint64_t file_size;
+} MySnapshotHeader;
+
+/// @brief Round up to the next multiple of MY_SNAPSHOT_ALIGNMENT.
+inline uint64_t my_snapshot_align(uint64_t offset) { return (offset + MY_SNAPSHOT_ALIGNMENT - 1) / MY_SNAPSHOT_ALIGNMENT * MY_SNAPSHOT_ALIGNMENT; }
+
+/// @brief Check that a snapshot header belongs to a hash table with these types and hash policy.
+/// @param header
+/// @param hasher
+/// @details Only checks the fields against each other: the sections lie in order within file_size. Whether the file
+/// is really that long must be checked by the caller before it allocates anything from these sizes.
+/// @return False if the snapshot cannot be used, e.g. because it has another version or item size.
+template <typename Key, typename Value, typename Hash>
+bool my_check_snapshot_header(const MySnapshotHeader &header, const Hash &hasher)
+{
+    return header.magic == MY_SNAPSHOT_MAGIC && header.version == MY_SNAPSHOT_VERSION &&
+           header.item_size == sizeof(MyItem<Key, Value>) && header.key_is_string == MyKeyTraits<Key>::is_string &&
+           header.hash_check == hasher(MY_SNAPSHOT_HASH_CHECK, sizeof(MY_SNAPSHOT_HASH_CHECK) - 1) &&
+           header.slot_count <= MY_SNAPSHOT_MAX_SIZE && header.key_arena_size <= MY_SNAPSHOT_MAX_SIZE &&
+           header.ctrl_offset <= MY_SNAPSHOT_MAX_SIZE && header.slots_offset <= MY_SNAPSHOT_MAX_SIZE &&
+           header.items_offset <= MY_SNAPSHOT_MAX_SIZE && header.key_arena_offset <= MY_SNAPSHOT_MAX_SIZE &&
+           header.file_size <= MY_SNAPSHOT_MAX_SIZE &&
+           header.slot_count >= header.count && header.slot_count > 0 && header.count < MY_NO_INDEX &&
+           header.ctrl_offset >= sizeof(MySnapshotHeader) &&
+           header.slots_offset >= header.ctrl_offset + header.slot_count + header.group_width &&
+           header.items_offset >= header.slots_offset + header.slot_count * sizeof(uint32_t) &&
+           header.key_arena_offset >= header.items_offset + header.count * sizeof(MyItem<Key, Value>) &&
+           header.file_size >= header.key_arena_offset + header.key_arena_size + sizeof(uint64_t);
+}
+
+/// @brief Hash table with linear probing that keeps track of the insertion/modification order.
+/// @tparam Key std::string (default), std::string_view, const char * or a trivially copyable type.
+/// String keys are copied into the hash table and looked up by std::string_view.
+/// @tparam Value Stored inline in the items.
+/// @tparam Hash Hash policy, see my_hash_policies.h.
+template <typename Key = std::string, typename Value = int, typename Hash = MyDjb2Hash>
 class MyHashTable
 {
+public:
+    typedef MyItem<Key, Value> Item;
+    typedef typename MyKeyTraits<Key>::lookup_type lookup_type;
+
 private:
-    /// @brief Items stored in the hash table.
-    MyItem **items;
-    /// @brief Capacity of the hash table.
-    unsigned long size;
+    /// @brief Slots of the hash table, new items are always inserted here.
+    MySlotTable table;
+    /// @brief Slots that are migrated to table while growing/compacting, ctrl is nullptr otherwise.
+    MySlotTable old_table;
+    /// @brief Next slot of old_table to migrate.
+    unsigned long rehash_index;
+    /// @brief True: the hash table grows with its load factor; False: fixed size.
+    bool growable;
+    /// @brief Items stored in the hash table, referenced by the slots.
+    MySegments<Item, MY_ITEMS_SEGMENT_SIZE> items;
+    /// @brief Number of items that have been allocated in the items segments so far.
+    uint32_t items_used;
+    /// @brief Head of the list of removed items that can be reused (linked by next_index).
+    uint32_t free_index;
+    /// @brief Storage of all string keys that are too long to be stored inline.
+    MyKeyArena key_arena;
+    /// @brief The hash policy.
+    Hash hasher;
     /// @brief Current number of elements stored in the hash table.
     unsigned long count;
+    /// @brief Number of deleted slots (tombstones) in table.
+    unsigned long tombstone_count;
     /// @brief Count the number of collisions.
     unsigned long collision_count;
     /// @brief Count the number of not inserted items.
     unsigned long missed_count;
-    /// @brief The most recently inserted/changed item in the hash table.
-    MyItem *last_item;
-    /// @brief The least recently inserted/changed item in the hash table.
-    MyItem *first_item;
-    unsigned long MyHashTable::hash(char *word);
-    MyItem *create_my_item(char *key, int *value);
-    void insert_my_item(unsigned long index, MyItem *item);
-    void free_my_item(MyItem *item);
-    MyItem *find(char *key);
+    /// @brief Bytes of removed keys in the key arena.
+    uint32_t key_garbage;
+    /// @brief Maximum number of items in cache mode (the first item is evicted), 0: no limit.
+    unsigned long capacity;
+    /// @brief True: get() makes the item the last item (LRU), only in cache mode.
+    bool promote_on_get;
+    /// @brief Cache statistics, only counted in cache mode.
+    unsigned long hit_count;
+    unsigned long miss_count;
+    unsigned long eviction_count;
+    /// @brief Index of the most recently inserted/changed item in the hash table.
+    uint32_t last_index;
+    /// @brief Index of the least recently inserted/changed item in the hash table.
+    uint32_t first_index;
+    /// @brief True: slot tables are not freed but kept in retired_tables, see set_retire_slot_tables().
+    bool retire_slot_tables;
+    std::vector<MySlotTable> retired_tables;
+
+    /// @brief Calculates the hash of a key with the hash policy. The hash modulo the size is used
+    /// as index in the hash table, the 7 highest bits are stored as tag in the slot's control byte.
+    /// @param key
+    /// @return
+    uint64_t hash(lookup_type key) { return my_hash_key<Key>(this->hasher, key); }
+
+    /// @brief Get the tag of a hash that is stored in the control byte.
+    static int8_t hash_tag(uint64_t key_hash) { return (int8_t)(key_hash >> 57); }
+
+    /// @brief Allocate the slots, all of them are empty.
+    /// @details Throws std::bad_alloc if the memory cannot be allocated, slot_table is left without slots then.
+    /// @param slot_table
+    /// @param size
+    void init_slot_table(MySlotTable *slot_table, unsigned long size)
+    {
+        // A group is loaded at every slot index, thus the table must hold at least one group.
+        unsigned long slot_count = size < MY_GROUP_WIDTH ? MY_GROUP_WIDTH : size;
+        int8_t *ctrl = (int8_t *)malloc(slot_count + MY_GROUP_WIDTH);
+        uint32_t *slots = (uint32_t *)malloc(slot_count * sizeof(uint32_t));
+        if (ctrl == nullptr || slots == nullptr)
+        {
+            free(ctrl);
+            free(slots);
+            *slot_table = {nullptr, nullptr, 0};
+            throw std::bad_alloc();
+        }
+        memset(ctrl, MY_CTRL_EMPTY, slot_count + MY_GROUP_WIDTH);
+        *slot_table = {ctrl, slots, slot_count};
+    }
+
+    /// @brief Free the slots, or keep them in retired_tables if optimistic readers may still use them.
+    /// @param slot_table
+    void free_slot_table(MySlotTable *slot_table)
+    {
+        if (this->retire_slot_tables && slot_table->ctrl != nullptr)
+        {
+            this->retired_tables.push_back(*slot_table);
+        }
+        else
+        {
+            free(slot_table->ctrl);
+            free(slot_table->slots);
+        }
+        *slot_table = {nullptr, nullptr, 0};
+    }
+
+    /// @brief Set the control byte of a slot and of its copy behind the last slot.
+    /// @param slot_table
+    /// @param index
+    /// @param value
+    void set_ctrl(MySlotTable *slot_table, unsigned long index, int8_t value)
+    {
+        slot_table->ctrl[index] = value;
+        if (index < MY_GROUP_WIDTH)
+        {
+            slot_table->ctrl[slot_table->size + index] = value;
+        }
+    }
+
+    /// @brief Find the slot of a key by probing linearly, one group of slots at a time.
+    /// @param slot_table
+    /// @param key
+    /// @param key_hash
+    /// @param free_slot Optional, set to the first empty or deleted slot of the probe sequence
+    /// (or slot_table->size if there is none) if the key is not found.
+    /// @return Slot index or slot_table->size if the key does not exist.
+    unsigned long find_in(const MySlotTable *slot_table, lookup_type key, uint64_t key_hash, unsigned long *free_slot)
+    {
+        int8_t tag = hash_tag(key_hash);
+        unsigned long index = (unsigned long)(key_hash % slot_table->size);
+        if (free_slot != nullptr)
+        {
+            *free_slot = slot_table->size;
+        }
+
+        // O(1) on average, O(n) where n is the size of the hash table: worst case, if the list is clustered/full
+        for (unsigned long probed = 0; probed < slot_table->size; probed += MY_GROUP_WIDTH)
+        {
+            unsigned long group = (index + probed) % slot_table->size;
+            const int8_t *group_ctrl = slot_table->ctrl + group;
+
+            // Only slots with a matching tag are compared, O(k) each, where k is the length of the key
+            for (MyGroupMask match = my_group_match(group_ctrl, tag); match != 0; match &= match - 1)
+            {
+                unsigned long slot_index = (group + my_lowest_bit(match)) % slot_table->size;
+                if (key_equals(this->items.at(slot_table->slots[slot_index]), key))
+                {
+                    return slot_index;
+                }
+            }
+
+            // Remember the first empty or deleted slot for an insert.
+            if (free_slot != nullptr && *free_slot == slot_table->size)
+            {
+                MyGroupMask available = my_group_match_available(group_ctrl);
+                if (available != 0)
+                {
+                    *free_slot = (group + my_lowest_bit(available)) % slot_table->size;
+                }
+            }
+
+            // Key does not exist if the probe sequence ends in this group.
+            if (my_group_match(group_ctrl, MY_CTRL_EMPTY) != 0)
+            {
+                break;
+            }
+        }
+        return slot_table->size;
+    }
+
+    /// @brief Find the first empty or deleted slot in the probe sequence of a hash.
+    /// @param slot_table
+    /// @param key_hash
+    /// @return Slot index or slot_table->size if the slots are full.
+    unsigned long find_free_slot(const MySlotTable *slot_table, uint64_t key_hash)
+    {
+        unsigned long index = (unsigned long)(key_hash % slot_table->size);
+        for (unsigned long probed = 0; probed < slot_table->size; probed += MY_GROUP_WIDTH)
+        {
+            unsigned long group = (index + probed) % slot_table->size;
+            MyGroupMask available = my_group_match_available(slot_table->ctrl + group);
+            if (available != 0)
+            {
+                return (group + my_lowest_bit(available)) % slot_table->size;
+            }
+        }
+        return slot_table->size;
+    }
+
+    /// @brief Find the slot of a key in the slots and, while migrating, in the old slots.
+    /// @param key
+    /// @param key_hash
+    /// @param slot_table Set to the slots where the key was found.
+    /// @param free_slot Optional, see find_in(). Always refers to table.
+    /// @return Slot index or (*slot_table)->size if the key does not exist.
+    unsigned long find_slot(lookup_type key, uint64_t key_hash, MySlotTable **slot_table, unsigned long *free_slot)
+    {
+        *slot_table = &this->table;
+        unsigned long slot_index = find_in(*slot_table, key, key_hash, free_slot);
+        if (slot_index == (*slot_table)->size && this->old_table.ctrl != nullptr)
+        {
+            *slot_table = &this->old_table;
+            slot_index = find_in(*slot_table, key, key_hash, nullptr);
+        }
+        return slot_index;
+    }
+
+    /// @brief Start migrating the items to new slots: the current slots become the old slots.
+    /// The items are migrated by rehash_step().
+    /// @details Used to grow (twice the size) and to compact (same size, but without tombstones).
+    /// @param size Size of the new slots.
+    void start_rehash(unsigned long size)
+    {
+        // Only happens if the migration is slower than the inserts, see MY_REHASH_STEP.
+        while (this->old_table.ctrl != nullptr)
+        {
+            rehash_step();
+        }
+        this->old_table = this->table;
+        this->rehash_index = 0;
+        this->tombstone_count = 0;
+        init_slot_table(&this->table, size);
+    }
+
+    /// @brief Start compacting the slots if too many of them are tombstones. Amortized O(1),
+    /// because the tombstones are removed by the incremental migration of rehash_step().
+    void compact_if_needed()
+    {
+        if (this->old_table.ctrl == nullptr && this->tombstone_count * MY_MAX_TOMBSTONE_DENOMINATOR > this->table.size)
+        {
+            start_rehash(this->table.size);
+        }
+    }
+
+    /// @brief Check if a removed slot can be marked as empty instead of deleted.
+    /// @details A probe sequence stops at the first group with an empty slot. If every group
+    /// (window of MY_GROUP_WIDTH slots) containing the slot has another empty slot, no probe
+    /// sequence has ever continued past this slot and it does not need a tombstone.
+    /// @param slot_table
+    /// @param index
+    /// @return
+    bool can_set_empty(const MySlotTable *slot_table, unsigned long index)
+    {
+        unsigned long before = (index + slot_table->size - MY_GROUP_WIDTH) % slot_table->size;
+        MyGroupMask empty_before = my_group_match(slot_table->ctrl + before, MY_CTRL_EMPTY);
+        MyGroupMask empty_after = my_group_match(slot_table->ctrl + index, MY_CTRL_EMPTY);
+        if (empty_before == 0 || empty_after == 0)
+        {
+            return false;
+        }
+        return my_lowest_bit(empty_after) + my_trailing_slots(empty_before) < MY_GROUP_WIDTH;
+    }
+
+    /// @brief Migrate the next MY_REHASH_STEP old slots to the new slots and free the old slots
+    /// once all items have been migrated. Does nothing if the hash table is not growing.
+    /// @details The items themselves do not move, only their index is inserted into the new slots.
+    /// Migrated old slots are marked as deleted to keep the probe sequences of the old slots intact.
+    void rehash_step()
+    {
+        if (this->old_table.ctrl == nullptr)
+        {
+            return;
+        }
+        unsigned long end = this->rehash_index + MY_REHASH_STEP;
+        if (end > this->old_table.size)
+        {
+            end = this->old_table.size;
+        }
+        for (; this->rehash_index < end; this->rehash_index++)
+        {
+            if (this->old_table.ctrl[this->rehash_index] >= 0)
+            {
+                uint32_t item_index = this->old_table.slots[this->rehash_index];
+                uint64_t key_hash = hash(get_key(this->items.at(item_index)));
+                unsigned long slot_index = find_free_slot(&this->table, key_hash);
+                set_ctrl(&this->table, slot_index, hash_tag(key_hash));
+                this->table.slots[slot_index] = item_index;
+                set_ctrl(&this->old_table, this->rehash_index, MY_CTRL_DELETED);
+            }
+        }
+        if (this->rehash_index == this->old_table.size)
+        {
+            free_slot_table(&this->old_table);
+        }
+    }
+
+    /// @brief Create a MyItem in the items segments, which is part of the hash table.
+    /// @details Reuses a removed item if possible, otherwise a new segment is allocated if the
+    /// last one is full. String keys longer than MY_INLINE_KEY_LENGTH are copied to the key arena.
+    /// @param key
+    /// @param value
+    /// @return Index of the new item.
+    template <typename... Args>
+    uint32_t create_my_item(lookup_type key, Args &&...args)
+    {
+        uint32_t item_index = this->free_index;
+        if (item_index != MY_NO_INDEX)
+        {
+            this->free_index = this->items.at(item_index)->next_index;
+        }
+        else
+        {
+            item_index = this->items_used++;
+            uint32_t offset;
+            this->items.allocate(this->items.locate(item_index, &offset));
+        }
+
+        Item *item = this->items.at(item_index);
+        new (&item->value) Value(std::forward<Args>(args)...);
+        item->prev_index = MY_NO_INDEX;
+        item->next_index = MY_NO_INDEX;
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            uint32_t key_length = (uint32_t)key.size();
+            item->key.length = key_length;
+            if (key_length <= MY_INLINE_KEY_LENGTH)
+            {
+                memcpy(item->key.inline_key, key.data(), key_length);
+                item->key.inline_key[key_length] = '\0';
+            }
+            else
+            {
+                item->key.offset = this->key_arena.store(key.data(), key_length);
+            }
+        }
+        else
+        {
+            item->key = key;
+        }
+        return item_index;
+    }
+
+    /// @brief Insert the item at the corresponding index and increases the count.
+    /// @param index
+    /// @param tag
+    /// @param item_index
+    void insert_my_item(unsigned long index, int8_t tag, uint32_t item_index)
+    {
+        set_ctrl(&this->table, index, tag);
+        this->table.slots[index] = item_index;
+        this->count++;
+    }
+
+    /// @brief Free the item so that it can be reused. Its key in the key arena is reclaimed by compact_keys_if_needed().
+    /// @param item_index
+    void free_my_item(uint32_t item_index)
+    {
+        Item *item = this->items.at(item_index);
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            if (item->key.length > MY_INLINE_KEY_LENGTH)
+            {
+                this->key_garbage += item->key.length + 1;
+            }
+        }
+        item->value.~Value();
+        item->next_index = this->free_index;
+        this->free_index = item_index;
+    }
+
+    /// @brief Append the item to the end of the recency chain, making it the last item.
+    /// @param item_index
+    void link_last(uint32_t item_index)
+    {
+        Item *item = this->items.at(item_index);
+        item->prev_index = this->last_index;
+        item->next_index = MY_NO_INDEX;
+        if (this->last_index != MY_NO_INDEX)
+        {
+            this->items.at(this->last_index)->next_index = item_index;
+        }
+        this->last_index = item_index;
+        if (this->first_index == MY_NO_INDEX)
+        {
+            this->first_index = item_index;
+        }
+    }
+
+    /// @brief Remove the item from the recency chain and link its neighbours together.
+    /// @param item_index
+    void unlink(uint32_t item_index)
+    {
+        Item *item = this->items.at(item_index);
+        // Update last/first references
+        if (this->last_index == item_index)
+        {
+            this->last_index = item->prev_index;
+        }
+        if (this->first_index == item_index)
+        {
+            this->first_index = item->next_index;
+        }
+        if (item->prev_index != MY_NO_INDEX)
+        {
+            this->items.at(item->prev_index)->next_index = item->next_index;
+        }
+        if (item->next_index != MY_NO_INDEX)
+        {
+            this->items.at(item->next_index)->prev_index = item->prev_index;
+        }
+        item->prev_index = MY_NO_INDEX;
+        item->next_index = MY_NO_INDEX;
+    }
+
+    /// @brief Compare the item's key with the given key. The lengths of string keys are compared first.
+    /// @param item
+    /// @param key
+    /// @return True if the keys are equal.
+    bool key_equals(const Item *item, lookup_type key)
+    {
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            if (item->key.length != key.size())
+            {
+                return false;
+            }
+            return memcmp(get_key(item).data(), key.data(), key.size()) == 0;
+        }
+        else
+        {
+            return item->key == key;
+        }
+    }
+
+    /// @brief Compare the key of an item that another thread may change meanwhile, see get_in_view().
+    /// @details The stored key is copied first, so that its length and offset are checked and used once.
+    bool key_equals_checked(const Item *item, lookup_type key)
+    {
+        typename MyKeyTraits<Key>::stored_type stored;
+        memcpy((void *)&stored, (const void *)&item->key, sizeof(stored));
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            if (stored.length != key.size())
+            {
+                return false;
+            }
+            const char *data = stored.length <= MY_INLINE_KEY_LENGTH ? stored.inline_key : this->key_arena.find(stored.offset, stored.length);
+            return data != nullptr && memcmp(data, key.data(), key.size()) == 0;
+        }
+        else
+        {
+            return stored == key;
+        }
+    }
+
+    /// @brief Remove the item of a full slot.
+    /// @param slot_table
+    /// @param slot_index
+    void remove_slot(MySlotTable *slot_table, unsigned long slot_index)
+    {
+        uint32_t item_index = slot_table->slots[slot_index];
+        unlink(item_index);
+
+        // Remove the item, a tombstone keeps the probe sequences of other keys intact if needed.
+        if (can_set_empty(slot_table, slot_index))
+        {
+            set_ctrl(slot_table, slot_index, MY_CTRL_EMPTY);
+        }
+        else
+        {
+            set_ctrl(slot_table, slot_index, MY_CTRL_DELETED);
+            if (slot_table == &this->table)
+            {
+                this->tombstone_count++;
+            }
+        }
+        free_my_item(item_index);
+        this->count--;
+        compact_if_needed();
+        compact_keys_if_needed();
+    }
+
+    /// @brief Remove all items and allocate new slots.
+    /// @param size
+    void clear(unsigned long size)
+    {
+        if constexpr (!std::is_trivially_destructible<Value>::value)
+        {
+            for (uint32_t i = this->first_index; i != MY_NO_INDEX; i = this->items.at(i)->next_index)
+            {
+                this->items.at(i)->value.~Value();
+            }
+        }
+        free_slot_table(&this->table);
+        free_slot_table(&this->old_table);
+        init_slot_table(&this->table, size);
+        this->rehash_index = 0;
+        this->items_used = 0;
+        this->free_index = MY_NO_INDEX;
+        this->key_arena.clear();
+        this->key_garbage = 0;
+        this->count = 0;
+        this->tombstone_count = 0;
+        this->first_index = MY_NO_INDEX;
+        this->last_index = MY_NO_INDEX;
+    }
+
+    /// @brief Remove the least recently inserted/changed (or used) item to make room in cache mode.
+    void evict_first()
+    {
+        lookup_type key = get_key(this->items.at(this->first_index));
+        MySlotTable *slot_table;
+        unsigned long slot_index = find_slot(key, hash(key), &slot_table, nullptr);
+        remove_slot(slot_table, slot_index);
+        this->eviction_count++;
+    }
+
+    /// @brief Copy the keys of all items to the beginning of the key arena if it consists mostly of removed keys.
+    /// @details O(bytes of the remaining keys), but at least as many bytes have been removed since the last
+    /// compaction, thus it is amortized O(1) per removed key. Keeps the key arena flat under key streams.
+    void compact_keys_if_needed()
+    {
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            if (this->key_garbage < MY_KEY_SEGMENT_SIZE ||
+                this->key_garbage * MY_MAX_KEY_GARBAGE_DENOMINATOR <= this->key_arena.get_size())
+            {
+                return;
+            }
+            std::string keys;
+            keys.reserve(this->key_arena.get_size() - this->key_garbage);
+            for (uint32_t i = this->first_index; i != MY_NO_INDEX; i = this->items.at(i)->next_index)
+            {
+                Item *item = this->items.at(i);
+                if (item->key.length > MY_INLINE_KEY_LENGTH)
+                {
+                    keys.append(this->key_arena.at(item->key.offset), item->key.length);
+                }
+            }
+            this->key_arena.clear();
+            size_t position = 0;
+            for (uint32_t i = this->first_index; i != MY_NO_INDEX; i = this->items.at(i)->next_index)
+            {
+                Item *item = this->items.at(i);
+                if (item->key.length > MY_INLINE_KEY_LENGTH)
+                {
+                    item->key.offset = this->key_arena.store(keys.data() + position, item->key.length);
+                    position += item->key.length;
+                }
+            }
+            this->key_garbage = 0;
+        }
+    }
+
+    /// @brief Find the item of a key or, if the key does not yet exist, create it with a value constructed
+    /// in place from args. One probe either way, an existing item is not changed.
+    /// @param key
+    /// @param key_hash
+    /// @param created Set to true if the item was created (it is the last item then).
+    /// @param args Arguments of the constructor of Value.
+    /// @return Index of the item or MY_NO_INDEX if the hash table is full.
+    template <typename... Args>
+    uint32_t find_or_emplace(lookup_type key, uint64_t key_hash, bool *created, Args &&...args)
+    {
+        rehash_step();
+        *created = false;
+
+        // Item does already exist.
+        unsigned long free_slot;
+        MySlotTable *slot_table;
+        unsigned long slot_index = find_slot(key, key_hash, &slot_table, &free_slot);
+        if (slot_index != slot_table->size)
+        {
+            return slot_table->slots[slot_index];
+        }
+
+        // Key does not yet exist: make room in cache mode by evicting the least recently changed (or used) item.
+        if (this->capacity != 0 && this->count >= this->capacity)
+        {
+            evict_first();
+            free_slot = find_free_slot(&this->table, key_hash);
+        }
+
+        // Grow (or compact if the slots are mostly used by tombstones).
+        if (this->growable && (this->count + this->tombstone_count + 1) * MY_MAX_LOAD_DENOMINATOR > this->table.size * MY_MAX_LOAD_NUMERATOR)
+        {
+            bool compact = this->old_table.ctrl == nullptr &&
+                           (this->count + 1) * 2 * MY_MAX_LOAD_DENOMINATOR <= this->table.size * MY_MAX_LOAD_NUMERATOR;
+            start_rehash(compact ? this->table.size : this->table.size * 2);
+            free_slot = find_free_slot(&this->table, key_hash);
+        }
+        else if (!this->growable && this->count >= this->table.size)
+        {
+            free_slot = this->table.size; // the old slots still hold items while compacting
+        }
+
+        // Insert the item.
+        if (free_slot != this->table.size)
+        {
+            // Handle collision with linear probing.
+            if (free_slot != key_hash % this->table.size)
+            {
+                this->collision_count++;
+            }
+            if (this->table.ctrl[free_slot] == MY_CTRL_DELETED)
+            {
+                this->tombstone_count--;
+            }
+            uint32_t item_index = create_my_item(key, std::forward<Args>(args)...);
+            insert_my_item(free_slot, hash_tag(key_hash), item_index);
+            link_last(item_index);
+            *created = true;
+            return item_index;
+        }
+
+        // The list is full and the item was not yet inserted.
+        // throw "The hash table is full";
+        this->collision_count++;
+        this->missed_count++;
+        return MY_NO_INDEX;
+    }
+
+    /// @brief See insert(), with the hash of the key.
+    void insert_hashed(lookup_type key, uint64_t key_hash, const Value &value)
+    {
+        bool created;
+        uint32_t item_index = find_or_emplace(key, key_hash, &created, value);
+        if (item_index == MY_NO_INDEX)
+        {
+            std::cerr << "Cannot insert (key: "
+                      << key << ", value: " << value
+                      << ") because hash table is full !!!"
+                      << std::endl;
+            return;
+        }
+        if (!created)
+        {
+            // Item does already exist: update its value and track most recently updated key "last".
+            this->items.at(item_index)->value = value;
+            unlink(item_index);
+            link_last(item_index);
+        }
+    }
+
+    /// @brief See get(), with the hash of the key.
+    Value *get_hashed(lookup_type key, uint64_t key_hash)
+    {
+        MySlotTable *slot_table;
+        unsigned long slot_index = find_slot(key, key_hash, &slot_table, nullptr);
+        if (slot_index == slot_table->size)
+        {
+            if (this->capacity != 0)
+            {
+                this->miss_count++;
+            }
+            return nullptr;
+        }
+        uint32_t item_index = slot_table->slots[slot_index];
+        if (this->capacity != 0)
+        {
+            this->hit_count++;
+            if (this->promote_on_get && item_index != this->last_index)
+            {
+                unlink(item_index);
+                link_last(item_index);
+            }
+        }
+        return &this->items.at(item_index)->value;
+    }
+
+    /// @brief Prefetch the control bytes and slots of the first group of a hash (first pass of a batch).
+    void prefetch_slots(uint64_t key_hash)
+    {
+        unsigned long index = (unsigned long)(key_hash % this->table.size);
+        my_prefetch(this->table.ctrl + index);
+        my_prefetch(this->table.slots + index);
+    }
+
+    /// @brief Prefetch the item of the first slot whose tag matches (second pass of a batch).
+    /// @return The item or nullptr if no tag matches in the first group.
+    Item *prefetch_item(uint64_t key_hash)
+    {
+        unsigned long index = (unsigned long)(key_hash % this->table.size);
+        MyGroupMask match = my_group_match(this->table.ctrl + index, hash_tag(key_hash));
+        if (match == 0)
+        {
+            return nullptr;
+        }
+        Item *item = this->items.at(this->table.slots[(index + my_lowest_bit(match)) % this->table.size]);
+        my_prefetch(item);
+        return item;
+    }
+
+    /// @brief Prefetch a key that is stored in the key arena (third pass of a batch).
+    void prefetch_key(const Item *item)
+    {
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            if (item->key.length > MY_INLINE_KEY_LENGTH)
+            {
+                my_prefetch(this->key_arena.at(item->key.offset));
+            }
+        }
+    }
+
+    /// @brief Hash a batch of keys and prefetch their slots, items and long keys, one pass at a time.
+    /// @details Every pass issues independent loads for all keys, thus their cache misses overlap instead of
+    /// being resolved one after another.
+    /// @param keys
+    /// @param count At most MY_BATCH_SIZE.
+    /// @param key_hashes Set to the hash of every key.
+    void prefetch_batch(const lookup_type *keys, size_t count, uint64_t *key_hashes)
+    {
+        Item *items[MY_BATCH_SIZE];
+        for (size_t i = 0; i < count; i++)
+        {
+            key_hashes[i] = hash(keys[i]);
+            prefetch_slots(key_hashes[i]);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            items[i] = prefetch_item(key_hashes[i]);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            if (items[i] != nullptr)
+            {
+                prefetch_key(items[i]);
+            }
+        }
+    }
 
 public:
-    MyHashTable(unsigned long size);
-    void insert(char *key, int *value);
-    void remove(char *key);
-    int *get(char *key);
-    MyItem *get_last();
-    MyItem *get_first();
-    void print_all();
+    /// @brief Constructor
+    /// @param size Capacity, or initial capacity if growable.
+    /// @param growable True: grow by migrating the items incrementally if 7/8 of the slots are used.
+    MyHashTable(unsigned long size, bool growable = false)
+    {
+        this->growable = growable;
+        this->count = 0;
+        this->missed_count = 0;
+        this->collision_count = 0;
+        this->key_garbage = 0;
+        this->capacity = 0;
+        this->promote_on_get = false;
+        this->hit_count = 0;
+        this->miss_count = 0;
+        this->eviction_count = 0;
+        this->tombstone_count = 0;
+        this->first_index = MY_NO_INDEX;
+        this->last_index = MY_NO_INDEX;
+        this->retire_slot_tables = false;
+        init_slot_table(&this->table, size);
+        this->old_table = {nullptr, nullptr, 0};
+        this->rehash_index = 0;
+        this->items_used = 0;
+        this->free_index = MY_NO_INDEX;
+    }
+
+    MyHashTable(const MyHashTable &) = delete;
+    MyHashTable &operator=(const MyHashTable &) = delete;
+
+    /// @brief Destructor
+    ~MyHashTable()
+    {
+        if constexpr (!std::is_trivially_destructible<Value>::value)
+        {
+            for (uint32_t i = this->first_index; i != MY_NO_INDEX; i = this->items.at(i)->next_index)
+            {
+                this->items.at(i)->value.~Value();
+            }
+        }
+        this->retire_slot_tables = false;
+        free_slot_table(&this->table);
+        free_slot_table(&this->old_table);
+        free_retired_slot_tables();
+    }
+
+    /// @brief Get the key of an item, e.g. of the item returned by get_first() or get_last().
+    /// @details String keys are terminated by '\0', thus data() can be used as C string.
+    /// The key is valid until the next insert or remove, since removing keys may compact the key arena.
+    /// @param item
+    /// @return
+    lookup_type get_key(const Item *item)
+    {
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            const char *key = item->key.length <= MY_INLINE_KEY_LENGTH ? item->key.inline_key : this->key_arena.at(item->key.offset);
+            return std::string_view(key, item->key.length);
+        }
+        else
+        {
+            return item->key;
+        }
+    }
+
+    /// @brief Print all non-empty entries of the hash table and the statistics.
+    void print_all()
+    {
+        using namespace std;
+        cout << "***My Hash Table***" << endl;
+        const MySlotTable *slot_tables[] = {&this->old_table, &this->table};
+        for (const MySlotTable *slot_table : slot_tables)
+        {
+            for (unsigned long i = 0; i < slot_table->size; i++)
+            {
+                if (slot_table->ctrl[i] >= 0)
+                {
+                    Item *item = this->items.at(slot_table->slots[i]);
+                    cout << (slot_table == &this->old_table ? "Old Index: " : "Index: ") << i
+                         << "\t Value: " << item->value
+                         << "\t Key: " << left << setw(30) << get_key(item)
+                         << "\t Prev Key: " << left << setw(30);
+                    if (item->prev_index == MY_NO_INDEX)
+                    {
+                        cout << "-";
+                    }
+                    else
+                    {
+                        cout << get_key(this->items.at(item->prev_index));
+                    }
+                    cout << "\t Next Key: ";
+                    if (item->next_index == MY_NO_INDEX)
+                    {
+                        cout << "-";
+                    }
+                    else
+                    {
+                        cout << get_key(this->items.at(item->next_index));
+                    }
+                    cout << endl;
+                }
+            }
+        }
+
+        cout << "\n\n------------------\n\n"
+             << "Count: " << this->count
+             << "\nSize: " << this->table.size
+             << "\nNr. of not inserted items: " << this->missed_count
+             << "\nNr. of collisions: " << this->collision_count
+             << "\nNr. of tombstones: " << this->tombstone_count
+             << "\nCache hits/misses/evictions: " << this->hit_count << "/" << this->miss_count << "/" << this->eviction_count
+             << "\nMemory (control bytes + slots + items + key arena): " << get_memory() << " bytes"
+             << endl;
+        print_stats();
+    }
+
+    /// @brief Get the bytes allocated for control bytes, slots, items and key arena. O(1)
+    size_t get_memory()
+    {
+        size_t memory = this->items.get_capacity() * sizeof(Item) + this->key_arena.get_capacity();
+        const MySlotTable *slot_tables[] = {&this->old_table, &this->table};
+        for (const MySlotTable *slot_table : slot_tables)
+        {
+            if (slot_table->ctrl != nullptr)
+            {
+                memory += slot_table->size * (1 + sizeof(uint32_t)) + MY_GROUP_WIDTH;
+            }
+        }
+        return memory;
+    }
+
+    /// @brief Collect the statistics of the hash table, e.g. to compare hash policies or sizes.
+    /// @details O(n + size): every key is hashed again to find its home slot.
+    /// @return
+    MyHashTableStats get_stats()
+    {
+        MyHashTableStats stats = {};
+        stats.count = this->count;
+        stats.size = this->table.size;
+        stats.tombstone_count = this->tombstone_count;
+        stats.load_factor = (double)(this->count + this->tombstone_count) / this->table.size;
+        stats.memory = get_memory();
+        stats.collision_count = this->collision_count;
+        stats.missed_count = this->missed_count;
+
+        double displacement_sum = 0;
+        double bucket_sum = 0;
+        double expected_bucket_sum = 0;
+        const MySlotTable *slot_tables[] = {&this->old_table, &this->table};
+        for (const MySlotTable *slot_table : slot_tables)
+        {
+            std::vector<uint32_t> home_counts(slot_table->size, 0);
+            unsigned long items = 0;
+            for (unsigned long i = 0; i < slot_table->size; i++)
+            {
+                if (slot_table->ctrl[i] < 0)
+                {
+                    continue;
+                }
+                unsigned long home = (unsigned long)(hash(get_key(this->items.at(slot_table->slots[i]))) % slot_table->size);
+                unsigned long displacement = (i + slot_table->size - home) % slot_table->size;
+                home_counts[home]++;
+                items++;
+                displacement_sum += displacement;
+                stats.max_displacement = std::max(stats.max_displacement, displacement);
+                stats.probe_histogram[std::min(displacement / MY_GROUP_WIDTH, MY_PROBE_HISTOGRAM_SIZE - 1)]++;
+            }
+            for (uint32_t home_count : home_counts)
+            {
+                bucket_sum += (double)home_count * (home_count + 1) / 2;
+            }
+            if (items > 0)
+            {
+                expected_bucket_sum += (double)items / (2.0 * slot_table->size) * (items + 2.0 * slot_table->size - 1);
+            }
+        }
+        stats.mean_displacement = this->count == 0 ? 0 : displacement_sum / this->count;
+        stats.distribution_quality = expected_bucket_sum == 0 ? 1 : bucket_sum / expected_bucket_sum;
+        return stats;
+    }
+
+    /// @brief Print the statistics of get_stats().
+    void print_stats()
+    {
+        using namespace std;
+        MyHashTableStats stats = get_stats();
+        cout << "Load factor: " << fixed << setprecision(3) << stats.load_factor
+             << "\nDisplacement (mean/max): " << stats.mean_displacement << "/" << stats.max_displacement
+             << "\nDistribution quality (1 = uniform): " << stats.distribution_quality
+             << "\nProbed groups (1, 2, ..., " << MY_PROBE_HISTOGRAM_SIZE << "+):";
+        for (unsigned long probes : stats.probe_histogram)
+        {
+            cout << " " << probes;
+        }
+        cout << defaultfloat << endl;
+    }
+
+    /// @brief Write a snapshot of the hash table to a binary stream, e.g. a std::ofstream opened with std::ios::binary.
+    /// @details Finishes a running migration first. The items are written in recency order and the free items
+    /// and removed keys are left out, thus the snapshot is compact. O(n), but no key is hashed.
+    /// The file can be restored with load() or memory-mapped with MyHashTableSnapshot.
+    /// @param out
+    /// @return False if writing failed.
+    bool save(std::ostream &out)
+    {
+        static_assert(std::is_trivially_copyable<Value>::value, "Value must be trivially copyable to be saved");
+        while (this->old_table.ctrl != nullptr)
+        {
+            rehash_step();
+        }
+
+        // Number the items in recency order and lay out the long keys in the same order.
+        std::vector<uint32_t> new_indexes(this->items_used, MY_NO_INDEX);
+        uint32_t new_index = 0;
+        uint64_t key_arena_size = 0;
+        for (uint32_t i = this->first_index; i != MY_NO_INDEX; i = this->items.at(i)->next_index)
+        {
+            new_indexes[i] = new_index++;
+            if constexpr (MyKeyTraits<Key>::is_string)
+            {
+                if (this->items.at(i)->key.length > MY_INLINE_KEY_LENGTH)
+                {
+                    key_arena_size += this->items.at(i)->key.length + 1;
+                }
+            }
+        }
+
+        MySnapshotHeader header = {};
+        header.magic = MY_SNAPSHOT_MAGIC;
+        header.version = MY_SNAPSHOT_VERSION;
+        header.group_width = (uint32_t)MY_GROUP_WIDTH;
+        header.item_size = (uint32_t)sizeof(Item);
+        header.key_is_string = MyKeyTraits<Key>::is_string;
+        header.hash_check = this->hasher(MY_SNAPSHOT_HASH_CHECK, sizeof(MY_SNAPSHOT_HASH_CHECK) - 1);
+        header.slot_count = this->table.size;
+        header.count = this->count;
+        header.ctrl_offset = my_snapshot_align(sizeof(MySnapshotHeader));
+        header.slots_offset = my_snapshot_align(header.ctrl_offset + this->table.size + MY_GROUP_WIDTH);
+        header.items_offset = my_snapshot_align(header.slots_offset + this->table.size * sizeof(uint32_t));
+        header.key_arena_offset = my_snapshot_align(header.items_offset + this->count * sizeof(Item));
+        header.key_arena_size = key_arena_size;
+        header.file_size = my_snapshot_align(header.key_arena_offset + key_arena_size) + sizeof(uint64_t);
+
+        // Every byte is added to the checksum in the trailer.
+        uint64_t position = 0;
+        uint32_t checksum = 0;
+        auto write = [&](const void *data, size_t size)
+        {
+            checksum = my_crc32c((const char *)data, size, checksum);
+            out.write((const char *)data, size);
+            position += size;
+        };
+        auto pad = [&](uint64_t offset)
+        {
+            const char zeros[MY_SNAPSHOT_ALIGNMENT] = {};
+            write(zeros, (size_t)(offset - position));
+        };
+        const uint32_t buffer_size = 4096;
+
+        write(&header, sizeof(header));
+        pad(header.ctrl_offset);
+        write(this->table.ctrl, this->table.size + MY_GROUP_WIDTH);
+        pad(header.slots_offset);
+        std::vector<uint32_t> slot_buffer;
+        slot_buffer.reserve(buffer_size);
+        for (unsigned long i = 0; i < this->table.size; i++)
+        {
+            slot_buffer.push_back(this->table.ctrl[i] >= 0 ? new_indexes[this->table.slots[i]] : 0);
+            if (slot_buffer.size() == buffer_size || i + 1 == this->table.size)
+            {
+                write(slot_buffer.data(), slot_buffer.size() * sizeof(uint32_t));
+                slot_buffer.clear();
+            }
+        }
+        pad(header.items_offset);
+        std::vector<Item> item_buffer;
+        item_buffer.reserve(buffer_size);
+        uint32_t key_offset = 0;
+        for (uint32_t i = this->first_index; i != MY_NO_INDEX; i = this->items.at(i)->next_index)
+        {
+            Item item;
+            memcpy((void *)&item, (const void *)this->items.at(i), sizeof(Item));
+            uint32_t index = new_indexes[i];
+            item.prev_index = index == 0 ? MY_NO_INDEX : index - 1;
+            item.next_index = index + 1 == this->count ? MY_NO_INDEX : index + 1;
+            if constexpr (MyKeyTraits<Key>::is_string)
+            {
+                if (item.key.length > MY_INLINE_KEY_LENGTH)
+                {
+                    item.key.offset = key_offset;
+                    key_offset += item.key.length + 1;
+                }
+            }
+            item_buffer.push_back(item);
+            if (item_buffer.size() == buffer_size || item.next_index == MY_NO_INDEX)
+            {
+                write(item_buffer.data(), item_buffer.size() * sizeof(Item));
+                item_buffer.clear();
+            }
+        }
+        pad(header.key_arena_offset);
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            for (uint32_t i = this->first_index; i != MY_NO_INDEX; i = this->items.at(i)->next_index)
+            {
+                Item *item = this->items.at(i);
+                if (item->key.length > MY_INLINE_KEY_LENGTH)
+                {
+                    write(this->key_arena.at(item->key.offset), item->key.length + 1);
+                }
+            }
+        }
+        pad(header.file_size - sizeof(uint64_t));
+        uint64_t trailer = checksum;
+        out.write((const char *)&trailer, sizeof(trailer));
+        return out.good();
+    }
+
+    /// @brief Replace the content of the hash table with a snapshot written by save().
+    /// @details The slots are copied as they are, no key is hashed (unless the snapshot was written with another
+    /// group width, see MySnapshotHeader). The size and the statistics are taken from the snapshot, the
+    /// growable flag and the cache mode are kept.
+    /// Nothing is allocated from the sizes in the header before it is known that the stream holds file_size bytes,
+    /// thus a corrupt header cannot make the process allocate more than the file.
+    /// @param in Seekable, e.g. a std::ifstream opened with std::ios::binary or a std::stringstream, positioned at
+    /// the start of the snapshot.
+    /// @return False if the snapshot is incompatible, incomplete or its checksum is wrong, or the stream is not
+    /// seekable. The hash table is empty then.
+    bool load(std::istream &in)
+    {
+        static_assert(std::is_trivially_copyable<Value>::value, "Value must be trivially copyable to be loaded");
+        MySnapshotHeader header;
+        std::istream::pos_type start = in.tellg();
+        uint64_t position = 0;
+        uint32_t checksum = 0;
+        auto read = [&](void *data, size_t size)
+        {
+            in.read((char *)data, size);
+            checksum = my_crc32c((const char *)data, size, checksum);
+            position += size;
+        };
+        auto skip = [&](uint64_t offset)
+        {
+            char padding[MY_SNAPSHOT_ALIGNMENT];
+            while (in.good() && position < offset)
+            {
+                read(padding, (size_t)std::min<uint64_t>(offset - position, sizeof(padding)));
+            }
+        };
+        read(&header, sizeof(header));
+        if (start == std::istream::pos_type(-1) || !in.good() || !my_check_snapshot_header<Key, Value, Hash>(header, this->hasher))
+        {
+            clear(MY_GROUP_WIDTH);
+            return false;
+        }
+        // The header is only consistent with itself: check that the stream is as long as it claims.
+        in.seekg(0, std::ios::end);
+        std::istream::pos_type end = in.tellg();
+        in.seekg(start + (std::streamoff)sizeof(header));
+        if (!in.good() || end == std::istream::pos_type(-1) || (uint64_t)(std::streamoff)(end - start) < header.file_size ||
+            header.slot_count != (unsigned long)header.slot_count)
+        {
+            clear(MY_GROUP_WIDTH);
+            return false;
+        }
+
+        // Slots: used in place if the probing is compatible, otherwise the items are inserted again below.
+        bool same_width = header.group_width == MY_GROUP_WIDTH && header.slot_count >= MY_GROUP_WIDTH;
+        clear((unsigned long)header.slot_count);
+        std::vector<int8_t> ctrl;
+        std::vector<uint32_t> slots;
+        skip(header.ctrl_offset);
+        if (same_width)
+        {
+            read(this->table.ctrl, this->table.size + MY_GROUP_WIDTH);
+        }
+        else
+        {
+            ctrl.resize(header.slot_count + header.group_width);
+            read(ctrl.data(), ctrl.size());
+        }
+        skip(header.slots_offset);
+        slots.resize(same_width ? 0 : header.slot_count);
+        read(same_width ? this->table.slots : slots.data(), header.slot_count * sizeof(uint32_t));
+
+        // Items: stored at their index in recency order, the free list is empty.
+        skip(header.items_offset);
+        for (uint32_t i = 0; i < header.count && in.good(); i++)
+        {
+            uint32_t offset;
+            this->items.allocate(this->items.locate(i, &offset));
+            read(this->items.at(i), sizeof(Item));
+        }
+        this->items_used = (uint32_t)header.count;
+        skip(header.key_arena_offset);
+        std::vector<char> keys(in.good() ? header.key_arena_size : 0);
+        read(keys.data(), keys.size());
+        skip(header.file_size - sizeof(uint64_t));
+        uint64_t trailer = 0;
+        in.read((char *)&trailer, sizeof(trailer));
+        if (!in.good() || trailer != checksum)
+        {
+            clear(MY_GROUP_WIDTH);
+            return false;
+        }
+
+        // Long keys are copied into the key arena, which has another layout than the snapshot.
+        for (uint32_t i = 0; i < header.count; i++)
+        {
+            Item *item = this->items.at(i);
+            item->prev_index = i == 0 ? MY_NO_INDEX : i - 1;
+            item->next_index = i + 1 == header.count ? MY_NO_INDEX : i + 1;
+            if constexpr (MyKeyTraits<Key>::is_string)
+            {
+                if (item->key.length > MY_INLINE_KEY_LENGTH)
+                {
+                    if ((uint64_t)item->key.offset + item->key.length >= keys.size())
+                    {
+                        clear(MY_GROUP_WIDTH);
+                        return false;
+                    }
+                    item->key.offset = this->key_arena.store(keys.data() + item->key.offset, item->key.length);
+                }
+            }
+            if (!same_width)
+            {
+                lookup_type key = get_key(item);
+                uint64_t key_hash = hash(key);
+                unsigned long slot_index = find_free_slot(&this->table, key_hash);
+                set_ctrl(&this->table, slot_index, hash_tag(key_hash));
+                this->table.slots[slot_index] = i;
+            }
+        }
+        this->count = (unsigned long)header.count;
+        this->first_index = header.count == 0 ? MY_NO_INDEX : 0;
+        this->last_index = header.count == 0 ? MY_NO_INDEX : (uint32_t)header.count - 1;
+        for (unsigned long i = 0; i < this->table.size; i++)
+        {
+            if (this->table.ctrl[i] == MY_CTRL_DELETED)
+            {
+                this->tombstone_count++;
+            }
+            else if (this->table.ctrl[i] >= 0 && this->table.slots[i] >= this->count)
+            {
+                clear(MY_GROUP_WIDTH);
+                return false;
+            }
+        }
+        while (this->capacity != 0 && this->count > this->capacity)
+        {
+            evict_first();
+        }
+        return true;
+    }
+
+    // -----------------------------------------------------------
+    // To be implemented with O(1)-complexity!
+    // -----------------------------------------------------------
+
+    /// @brief Insert key-value pair as MyItem or updates the key's existing value.
+    /// @details Inserted and updated items become the most recently changed item (last).
+    /// While growing, every insert migrates MY_REHASH_STEP slots, which keeps it O(1).
+    /// @param key
+    /// @param value
+    void insert(lookup_type key, const Value &value) { insert_hashed(key, hash(key), value); }
+
+    /// @brief Removes MyItem from the hash table by key.
+    /// @param key
+    void remove(lookup_type key)
+    {
+        uint64_t key_hash = hash(key);
+        rehash_step();
+
+        MySlotTable *slot_table;
+        unsigned long slot_index = find_slot(key, key_hash, &slot_table, nullptr);
+        if (slot_index != slot_table->size)
+        {
+            remove_slot(slot_table, slot_index);
+        }
+    }
+
+    /// @brief Get the value of the corresponding key.
+    /// @details The pointer stays valid until the key is removed. Only changes the hash table in cache mode
+    /// (statistics and promotion), thus concurrent calls are safe otherwise.
+    /// @param key
+    /// @return
+    Value *get(lookup_type key) { return get_hashed(key, hash(key)); }
+
+    /// @brief Slots and items as seen by an optimistic reader, see get_read_view().
+    struct ReadView
+    {
+        MySlotTable table;
+        MySlotTable old_table;
+        uint32_t items_used;
+    };
+
+    /// @brief Copy the references to the slots and items for get_in_view().
+    /// @details Another thread may change the hash table meanwhile, thus the caller must check that no writer ran
+    /// while the view was copied (e.g. with the sequence number of a seqlock) before using it.
+    ReadView get_read_view() { return {this->table, this->old_table, this->items_used}; }
+
+    /// @brief Look a key up in a view while another thread may change the hash table (optimistic read).
+    /// @details Every index and key offset that is read is checked against the view and the allocated
+    /// segments, thus a reader never leaves the memory of the hash table, even if it reads half-written slots or
+    /// items. Items and key segments are never freed before the destructor, slot tables must be kept alive by
+    /// set_retire_slot_tables(). The result is only valid if no writer ran meanwhile, the caller must check this
+    /// afterwards and retry otherwise. Never changes the hash table.
+    /// @param view A view whose copy was not overlapped by a writer.
+    /// @param key
+    /// @param key_hash Hash of the key with the hash policy of this hash table.
+    /// @param value Set to a copy of the value if the key was found.
+    /// @return
+    bool get_in_view(const ReadView &view, lookup_type key, uint64_t key_hash, Value *value)
+    {
+        static_assert(std::is_trivially_copyable<Value>::value, "Value must be trivially copyable to be read optimistically");
+        int8_t tag = hash_tag(key_hash);
+        for (const MySlotTable *slot_table : {&view.table, &view.old_table})
+        {
+            if (slot_table->ctrl == nullptr || slot_table->size == 0)
+            {
+                continue;
+            }
+            unsigned long index = (unsigned long)(key_hash % slot_table->size);
+            for (unsigned long probed = 0; probed < slot_table->size; probed += MY_GROUP_WIDTH)
+            {
+                unsigned long group = (index + probed) % slot_table->size;
+                const int8_t *group_ctrl = slot_table->ctrl + group;
+                for (MyGroupMask match = my_group_match(group_ctrl, tag); match != 0; match &= match - 1)
+                {
+                    uint32_t item_index = slot_table->slots[(group + my_lowest_bit(match)) % slot_table->size];
+                    if (item_index >= view.items_used)
+                    {
+                        continue;
+                    }
+                    Item *item = this->items.at(item_index);
+                    if (key_equals_checked(item, key))
+                    {
+                        memcpy((void *)value, (const void *)&item->value, sizeof(Value));
+                        return true;
+                    }
+                }
+                if (my_group_match(group_ctrl, MY_CTRL_EMPTY) != 0)
+                {
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+
+    /// @brief Keep slot tables that are replaced (after growing or compacting and by clear()) instead of freeing
+    /// them, until free_retired_slot_tables(). For optimistic readers that may still probe them, see get_in_view().
+    /// @param retire
+    void set_retire_slot_tables(bool retire) { this->retire_slot_tables = retire; }
+
+    /// @brief Get the number of slot tables that have been retired and not yet freed.
+    size_t get_retired_slot_table_count() { return this->retired_tables.size(); }
+
+    /// @brief Free the retired slot tables, once no reader can use them anymore.
+    void free_retired_slot_tables()
+    {
+        for (MySlotTable &slot_table : this->retired_tables)
+        {
+            free(slot_table.ctrl);
+            free(slot_table.slots);
+        }
+        this->retired_tables.clear();
+    }
+
+    /// @brief Insert a key with a value constructed in place from args, if the key does not yet exist.
+    /// @details An existing item is neither changed nor moved in the recency chain, nothing is constructed then.
+    /// One probe and no allocation if the key exists.
+    /// @param key
+    /// @param args Arguments of the constructor of Value.
+    /// @return Value of the key and true if it was inserted. nullptr if the hash table is full.
+    template <typename... Args>
+    std::pair<Value *, bool> try_emplace(lookup_type key, Args &&...args)
+    {
+        bool created;
+        uint32_t item_index = find_or_emplace(key, hash(key), &created, std::forward<Args>(args)...);
+        if (item_index == MY_NO_INDEX)
+        {
+            std::cerr << "Cannot insert (key: " << key << ") because hash table is full !!!" << std::endl;
+            return {nullptr, false};
+        }
+        return {&this->items.at(item_index)->value, created};
+    }
+
+    /// @brief Update the value of a key in place, e.g. upsert(word, [](int &count) { count++; }) to count words.
+    /// @details If the key does not yet exist, its value is constructed from initial first. Then update is called
+    /// with the value and the item becomes the last item. One probe and no allocation if the key exists.
+    /// @param key
+    /// @param update Called with Value &.
+    /// @param initial Value of a new key before update is called.
+    /// @return The updated value, nullptr if the key does not exist and the hash table is full.
+    template <typename Update>
+    Value *upsert(lookup_type key, Update update, const Value &initial = Value())
+    {
+        bool created;
+        uint32_t item_index = find_or_emplace(key, hash(key), &created, initial);
+        if (item_index == MY_NO_INDEX)
+        {
+            std::cerr << "Cannot insert (key: " << key << ") because hash table is full !!!" << std::endl;
+            return nullptr;
+        }
+        if (!created)
+        {
+            unlink(item_index);
+            link_last(item_index);
+        }
+        Value *value = &this->items.at(item_index)->value;
+        update(*value);
+        return value;
+    }
+
+    /// @brief Insert many key-value pairs, same result as calling insert() for each of them in order.
+    /// @details The keys are processed in batches of MY_BATCH_SIZE: all keys of a batch are hashed and their slots,
+    /// items and long keys are prefetched before the first of them is inserted. For hash tables larger than the
+    /// CPU caches this hides most of the memory latency.
+    /// @param keys
+    /// @param values One value per key.
+    /// @param count
+    void insert_batch(const lookup_type *keys, const Value *values, size_t count)
+    {
+        uint64_t key_hashes[MY_BATCH_SIZE];
+        for (size_t start = 0; start < count; start += MY_BATCH_SIZE)
+        {
+            size_t batch_count = std::min<size_t>(MY_BATCH_SIZE, count - start);
+            prefetch_batch(keys + start, batch_count, key_hashes);
+            for (size_t i = 0; i < batch_count; i++)
+            {
+                insert_hashed(keys[start + i], key_hashes[i], values[start + i]);
+            }
+        }
+    }
+
+    /// @brief Get the values of many keys, same result as calling get() for each of them in order.
+    /// @details See insert_batch().
+    /// @param keys
+    /// @param count
+    /// @param values Set to the value of every key, nullptr if the key does not exist.
+    void get_batch(const lookup_type *keys, size_t count, Value **values)
+    {
+        uint64_t key_hashes[MY_BATCH_SIZE];
+        for (size_t start = 0; start < count; start += MY_BATCH_SIZE)
+        {
+            size_t batch_count = std::min<size_t>(MY_BATCH_SIZE, count - start);
+            prefetch_batch(keys + start, batch_count, key_hashes);
+            for (size_t i = 0; i < batch_count; i++)
+            {
+                values[start + i] = get_hashed(keys[start + i], key_hashes[i]);
+            }
+        }
+    }
+
+    /// @brief Turn the hash table into a bounded cache: inserting a new key while it holds capacity
+    /// items evicts the first item in O(1) instead of failing. Memory stays flat under unbounded key streams.
+    /// @param capacity Maximum number of items, at most the size of a fixed-size hash table. 0: no limit.
+    /// @param promote_on_get True: get() makes the item the last item, so that the least recently used item
+    /// is evicted (LRU). False: the least recently inserted/changed item is evicted.
+    void set_capacity(unsigned long capacity, bool promote_on_get = false)
+    {
+        this->capacity = this->growable ? capacity : std::min(capacity, this->table.size);
+        this->promote_on_get = promote_on_get;
+        while (this->capacity != 0 && this->count > this->capacity)
+        {
+            evict_first();
+        }
+    }
+
+    /// @brief Get the number of get() calls that found their key in cache mode.
+    unsigned long get_hit_count() { return this->hit_count; } // O(1)
+
+    /// @brief Get the number of get() calls that did not find their key in cache mode.
+    unsigned long get_miss_count() { return this->miss_count; } // O(1)
+
+    /// @brief Get the number of items that were evicted in cache mode.
+    unsigned long get_eviction_count() { return this->eviction_count; } // O(1)
+
+    /// @brief Get the current number of elements stored in the hash table.
+    /// @return
+    unsigned long get_count() { return this->count; } // O(1)
+
+    /// @brief Get the item that was inserted/changed after the given item, to iterate from get_first().
+    /// @param item
+    /// @return nullptr if the item is the last item.
+    Item *get_next(const Item *item) { return item->next_index == MY_NO_INDEX ? nullptr : this->items.at(item->next_index); } // O(1)
+
+    /// @brief Get the item that was inserted/changed before the given item, to iterate from get_last().
+    /// @param item
+    /// @return nullptr if the item is the first item.
+    Item *get_prev(const Item *item) { return item->prev_index == MY_NO_INDEX ? nullptr : this->items.at(item->prev_index); } // O(1)
+
+    /// @brief Get the number of tombstones, i.e. slots of removed items that still have to be skipped by probing.
+    /// @return
+    unsigned long get_tombstone_count() { return this->tombstone_count; } // O(1)
+
+    /// @brief Get the share of slots that are tombstones (0 to 1). The slots are compacted if it exceeds 1/4.
+    /// @return
+    double get_tombstone_density() { return (double)this->tombstone_count / this->table.size; } // O(1)
+
+    /// @brief Get the most recently inserted/changed item.
+    /// @details The pointer stays valid until the item is removed, use get_key() to read its key.
+    /// @return
+    Item *get_last() { return this->last_index == MY_NO_INDEX ? nullptr : this->items.at(this->last_index); } // O(1)
+
+    /// @brief Get the least recently inserted/changed item.
+    /// @details The pointer stays valid until the item is removed, use get_key() to read its key.
+    /// @return
+    Item *get_first() { return this->first_index == MY_NO_INDEX ? nullptr : this->items.at(this->first_index); } // O(1)
 };
 
 #endif
@@ -0,0 +1,158 @@
+#include "my_hash_table.h"
+#include "my_mapped_file.h"
+
+#ifndef __MY_HASH_TABLE_SNAPSHOT_H__
+#define __MY_HASH_TABLE_SNAPSHOT_H__
+
+/// @brief Read-only hash table that serves lookups directly from a memory-mapped snapshot (see MyHashTable::save()).
+/// @details Nothing is deserialized or rehashed: the slots, items and keys are used where they are in the file and
+/// the operating system loads the pages on first access. Thus a process can serve get() right after open().
+/// @tparam Key See MyHashTable. Must be the same as the one of the saved hash table.
+/// @tparam Value See MyHashTable. Must be the same as the one of the saved hash table.
+/// @tparam Hash See MyHashTable. Must be the same as the one of the saved hash table.
+template <typename Key = std::string, typename Value = int, typename Hash = MyDjb2Hash>
+class MyHashTableSnapshot
+{
+public:
+    typedef MyItem<Key, Value> Item;
+    typedef typename MyKeyTraits<Key>::lookup_type lookup_type;
+
+private:
+    MyMappedFile file;
+    const MySnapshotHeader *header = nullptr;
+    const int8_t *ctrl = nullptr;
+    const uint32_t *slots = nullptr;
+    const Item *items = nullptr;
+    const char *key_arena = nullptr;
+    /// @brief The hash policy.
+    Hash hasher;
+
+    bool key_equals(const Item *item, lookup_type key)
+    {
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            return item->key.length == key.size() && memcmp(get_key(item).data(), key.data(), key.size()) == 0;
+        }
+        else
+        {
+            return item->key == key;
+        }
+    }
+
+public:
+    /// @brief Map a snapshot file.
+    /// @param path
+    /// @param verify True: check the CRC-32C of the whole file, which reads every page once. False: only the
+    /// header is checked, for files whose integrity is known (e.g. written by this process).
+    /// @return False if the file cannot be mapped, is not compatible or its checksum is wrong.
+    bool open(const char *path, bool verify = true)
+    {
+        close();
+        if (!this->file.open(path) || this->file.get_size() < sizeof(MySnapshotHeader))
+        {
+            close();
+            return false;
+        }
+        const char *data = this->file.get_data();
+        const MySnapshotHeader *file_header = (const MySnapshotHeader *)data;
+        // The probing of the snapshot must match the probing of this build, see MySnapshotHeader.
+        if (!my_check_snapshot_header<Key, Value, Hash>(*file_header, this->hasher) || file_header->group_width != MY_GROUP_WIDTH ||
+            file_header->slot_count < MY_GROUP_WIDTH || file_header->file_size != this->file.get_size())
+        {
+            close();
+            return false;
+        }
+        if (verify)
+        {
+            uint64_t trailer;
+            memcpy(&trailer, data + file_header->file_size - sizeof(trailer), sizeof(trailer));
+            if (my_crc32c(data, (size_t)(file_header->file_size - sizeof(trailer))) != trailer)
+            {
+                close();
+                return false;
+            }
+        }
+        this->header = file_header;
+        this->ctrl = (const int8_t *)(data + file_header->ctrl_offset);
+        this->slots = (const uint32_t *)(data + file_header->slots_offset);
+        this->items = (const Item *)(data + file_header->items_offset);
+        this->key_arena = data + file_header->key_arena_offset;
+        return true;
+    }
+
+    /// @brief Unmap the file, items and keys become invalid.
+    void close()
+    {
+        this->file.close();
+        this->header = nullptr;
+        this->ctrl = nullptr;
+        this->slots = nullptr;
+        this->items = nullptr;
+        this->key_arena = nullptr;
+    }
+
+    /// @brief Get the key of an item.
+    /// @param item
+    /// @return
+    lookup_type get_key(const Item *item)
+    {
+        if constexpr (MyKeyTraits<Key>::is_string)
+        {
+            const char *key = item->key.length <= MY_INLINE_KEY_LENGTH ? item->key.inline_key : this->key_arena + item->key.offset;
+            return std::string_view(key, item->key.length);
+        }
+        else
+        {
+            return item->key;
+        }
+    }
+
+    /// @brief Get the value of the corresponding key, probing like MyHashTable.
+    /// @param key
+    /// @return nullptr if the key does not exist or no snapshot is open.
+    const Value *get(lookup_type key)
+    {
+        if (this->header == nullptr)
+        {
+            return nullptr;
+        }
+        uint64_t key_hash = my_hash_key<Key>(this->hasher, key);
+        int8_t tag = (int8_t)(key_hash >> 57);
+        unsigned long size = (unsigned long)this->header->slot_count;
+        unsigned long index = (unsigned long)(key_hash % size);
+        for (unsigned long probed = 0; probed < size; probed += MY_GROUP_WIDTH)
+        {
+            unsigned long group = (index + probed) % size;
+            for (MyGroupMask match = my_group_match(this->ctrl + group, tag); match != 0; match &= match - 1)
+            {
+                const Item *item = &this->items[this->slots[(group + my_lowest_bit(match)) % size]];
+                if (key_equals(item, key))
+                {
+                    return &item->value;
+                }
+            }
+            if (my_group_match(this->ctrl + group, MY_CTRL_EMPTY) != 0)
+            {
+                break;
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief Get the number of items.
+    unsigned long get_count() { return this->header == nullptr ? 0 : (unsigned long)this->header->count; }
+
+    /// @brief Get the most recently inserted/changed item when the snapshot was saved.
+    const Item *get_last() { return get_count() == 0 ? nullptr : &this->items[get_count() - 1]; } // O(1)
+
+    /// @brief Get the least recently inserted/changed item when the snapshot was saved.
+    const Item *get_first() { return get_count() == 0 ? nullptr : &this->items[0]; } // O(1)
+
+    /// @brief Get the item after the given item in recency order.
+    const Item *get_next(const Item *item) { return item->next_index == MY_NO_INDEX ? nullptr : &this->items[item->next_index]; } // O(1)
+
+    /// @brief Get the item before the given item in recency order.
+    const Item *get_prev(const Item *item) { return item->prev_index == MY_NO_INDEX ? nullptr : &this->items[item->prev_index]; } // O(1)
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include <cstddef>
+#include <string_view>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef __MY_MAPPED_FILE_H__
+#define __MY_MAPPED_FILE_H__
+
+/// @brief Read-only memory mapping of a whole file, the operating system loads its pages on demand.
+/// @details No copy of the file is made, thus multi-gigabyte files can be read without reading them
+/// into a buffer first. The mapping is removed by close() or the destructor.
+class MyMappedFile
+{
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    MyMappedFile() = default;
+    MyMappedFile(const MyMappedFile &) = delete;
+    MyMappedFile &operator=(const MyMappedFile &) = delete;
+
+    /// @brief Destructor
+    ~MyMappedFile() { close(); }
+
+    /// @brief Map a file, a previously mapped file is closed.
+    /// @param path
+    /// @return False if the file cannot be opened or mapped.
+    bool open(const char *path)
+    {
+        close();
+#if defined(_WIN32)
+        this->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER file_size;
+        if (this->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(this->file, &file_size))
+        {
+            close();
+            return false;
+        }
+        this->size = (size_t)file_size.QuadPart;
+        if (this->size == 0)
+        {
+            return true; // empty files cannot be mapped
+        }
+        this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        this->data = this->mapping == nullptr ? nullptr : (const char *)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        int fd = ::open(path, O_RDONLY);
+        struct stat file_stat;
+        if (fd < 0 || fstat(fd, &file_stat) != 0)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            return false;
+        }
+        this->size = (size_t)file_stat.st_size;
+        if (this->size == 0)
+        {
+            ::close(fd);
+            return true; // empty files cannot be mapped
+        }
+        void *mapped = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file open
+        this->data = mapped == MAP_FAILED ? nullptr : (const char *)mapped;
+        if (this->data != nullptr)
+        {
+            madvise(mapped, this->size, MADV_SEQUENTIAL);
+        }
+#endif
+        if (this->data == nullptr)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Remove the mapping, views of the file become invalid.
+    void close()
+    {
+#if defined(_WIN32)
+        if (this->data != nullptr)
+        {
+            UnmapViewOfFile(this->data);
+        }
+        if (this->mapping != nullptr)
+        {
+            CloseHandle(this->mapping);
+        }
+        if (this->file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(this->file);
+        }
+        this->mapping = nullptr;
+        this->file = INVALID_HANDLE_VALUE;
+#else
+        if (this->data != nullptr)
+        {
+            munmap((void *)this->data, this->size);
+        }
+#endif
+        this->data = nullptr;
+        this->size = 0;
+    }
+
+    /// @brief Get the content of the file, valid until the file is closed.
+    std::string_view view() { return std::string_view(this->data, this->size); }
+
+    const char *get_data() { return this->data; }
+    size_t get_size() { return this->size; }
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "my_hash_table.h"
+
+#ifndef __MY_TOKENIZER_H__
+#define __MY_TOKENIZER_H__
+
+// -----------------------------------------------------------
+// Tokenizer: splits a text into words without copying it. Like iswpunct() + "stream >> word" in the C
+// locale, words are separated by ASCII whitespace and punctuation. All other bytes, e.g. UTF-8
+// sequences, are part of the words.
+// -----------------------------------------------------------
+
+/// @brief Number of bytes classified at once by my_delimiter_mask().
+const size_t MY_TOKENIZER_BLOCK_SIZE = 64;
+/// @brief Minimum number of bytes per thread of my_ingest_words(), smaller texts use fewer threads.
+const size_t MY_INGEST_MIN_CHUNK_SIZE = 1 << 20;
+/// @brief Initial size of the hash table of each thread of my_ingest_words().
+const unsigned long MY_INGEST_LOCAL_TABLE_SIZE = 1 << 14;
+
+/// @brief Delimiter flag per byte for the scalar tokenizer and the end of the text.
+struct MyDelimiterTable
+{
+    bool values[256];
+    constexpr MyDelimiterTable() : values()
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            values[c] = (c >= 0x09 && c <= 0x0D) || (c >= 0x20 && c <= 0x2F) || (c >= 0x3A && c <= 0x40) ||
+                        (c >= 0x5B && c <= 0x60) || (c >= 0x7B && c <= 0x7E);
+        }
+    }
+};
+
+/// @brief Index of the lowest set bit, mask must not be 0.
+inline unsigned int my_lowest_bit64(uint64_t mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return index;
+#elif defined(_MSC_VER)
+    return (uint32_t)mask != 0 ? my_lowest_bit((uint32_t)mask) : 32 + my_lowest_bit((uint32_t)(mask >> 32));
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+#if defined(MY_GROUP_SSE2) || defined(MY_GROUP_AVX2)
+/// @brief Get the bytes in [low, high] (both ASCII). Bytes >= 0x80 are negative and never match.
+inline __m128i my_in_range(__m128i bytes, char low, char high)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8(high + 1)));
+}
+#endif
+
+#if defined(MY_GROUP_AVX2)
+/// @brief Get the bytes in [low, high] (both ASCII). Bytes >= 0x80 are negative and never match.
+inline __m256i my_in_range(__m256i bytes, char low, char high)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(low - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), bytes));
+}
+#endif
+
+/// @brief Classify MY_TOKENIZER_BLOCK_SIZE bytes at once.
+/// @param data
+/// @return Bit i is set if data[i] is whitespace or punctuation.
+inline uint64_t my_delimiter_mask(const char *data)
+{
+    uint64_t mask = 0;
+#if defined(MY_GROUP_AVX2)
+    for (size_t i = 0; i < MY_TOKENIZER_BLOCK_SIZE; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i delimiters = _mm256_or_si256(
+            _mm256_or_si256(my_in_range(bytes, 0x09, 0x0D), my_in_range(bytes, 0x20, 0x2F)),
+            _mm256_or_si256(_mm256_or_si256(my_in_range(bytes, 0x3A, 0x40), my_in_range(bytes, 0x5B, 0x60)), my_in_range(bytes, 0x7B, 0x7E)));
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(delimiters) << i;
+    }
+#elif defined(MY_GROUP_SSE2)
+    for (size_t i = 0; i < MY_TOKENIZER_BLOCK_SIZE; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i delimiters = _mm_or_si128(
+            _mm_or_si128(my_in_range(bytes, 0x09, 0x0D), my_in_range(bytes, 0x20, 0x2F)),
+            _mm_or_si128(_mm_or_si128(my_in_range(bytes, 0x3A, 0x40), my_in_range(bytes, 0x5B, 0x60)), my_in_range(bytes, 0x7B, 0x7E)));
+        mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(delimiters) << i;
+    }
+#else
+    static constexpr MyDelimiterTable table;
+    for (size_t i = 0; i < MY_TOKENIZER_BLOCK_SIZE; i++)
+    {
+        mask |= (uint64_t)table.values[(unsigned char)data[i]] << i;
+    }
+#endif
+    return mask;
+}
+
+/// @brief Call on_word(std::string_view) for every word of the text, in order. The words are views into the text.
+/// @details Classifies 64 bytes at once and jumps from word boundary to word boundary with bit operations,
+/// thus the cost depends on the number of words rather than the number of bytes.
+/// @param text
+/// @param on_word
+template <typename OnWord>
+void my_tokenize(std::string_view text, OnWord on_word)
+{
+    const char *data = text.data();
+    size_t size = text.size();
+    bool in_word = false;
+    size_t word_start = 0;
+    char tail[MY_TOKENIZER_BLOCK_SIZE];
+    for (size_t block = 0; block < size; block += MY_TOKENIZER_BLOCK_SIZE)
+    {
+        uint64_t delimiters;
+        if (block + MY_TOKENIZER_BLOCK_SIZE <= size)
+        {
+            delimiters = my_delimiter_mask(data + block);
+        }
+        else
+        {
+            // The last block is padded with spaces, so that no byte behind the text is read.
+            memset(tail, ' ', MY_TOKENIZER_BLOCK_SIZE);
+            memcpy(tail, data + block, size - block);
+            delimiters = my_delimiter_mask(tail);
+        }
+        // Bit i is set where a word starts or ends (the class differs from the previous byte).
+        uint64_t words = ~delimiters;
+        uint64_t boundaries = words ^ ((words << 1) | (in_word ? 1 : 0));
+        while (boundaries != 0)
+        {
+            size_t position = block + my_lowest_bit64(boundaries);
+            if (in_word)
+            {
+                on_word(std::string_view(data + word_start, position - word_start));
+            }
+            else
+            {
+                word_start = position;
+            }
+            in_word = !in_word;
+            boundaries &= boundaries - 1;
+        }
+    }
+    if (in_word)
+    {
+        on_word(std::string_view(data + word_start, size - word_start));
+    }
+}
+
+/// @brief Insert every word of a text into the hash table, the value is the index of its last occurrence.
+/// @details Same result as inserting word by word on one thread (values and recency order). The text is
+/// split at delimiters into one chunk per thread, every thread fills its own growable hash table and the
+/// tables are merged in the order of the chunks: a word's last insert then comes from the chunk of its
+/// last occurrence. No string is allocated for the words, only the hash tables copy their keys.
+/// @param text E.g. a memory-mapped file (MyMappedFile).
+/// @param table
+/// @param thread_count 0: number of hardware threads. Reduced for small texts.
+/// @return Number of words.
+template <typename Key, typename Value, typename Hash>
+uint64_t my_ingest_words(std::string_view text, MyHashTable<Key, Value, Hash> &table, unsigned thread_count = 0)
+{
+    static constexpr MyDelimiterTable delimiter_table;
+    if (thread_count == 0)
+    {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = (unsigned)std::min<size_t>(thread_count, text.size() / MY_INGEST_MIN_CHUNK_SIZE + 1);
+
+    // Split the text behind a delimiter, so that no word is cut.
+    std::vector<size_t> chunk_starts(thread_count + 1, text.size());
+    chunk_starts[0] = 0;
+    for (unsigned t = 1; t < thread_count; t++)
+    {
+        size_t position = std::max(chunk_starts[t - 1], text.size() / thread_count * t);
+        while (position < text.size() && !delimiter_table.values[(unsigned char)text[position]])
+        {
+            position++;
+        }
+        chunk_starts[t] = position;
+    }
+
+    if (thread_count == 1)
+    {
+        uint64_t index = 0;
+        my_tokenize(text, [&](std::string_view word)
+                    { table.insert(word, (Value)index++); });
+        return index;
+    }
+
+    std::vector<std::unique_ptr<MyHashTable<Key, Value, Hash>>> tables(thread_count);
+    std::vector<uint64_t> word_counts(thread_count, 0);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count; t++)
+    {
+        tables[t] = std::make_unique<MyHashTable<Key, Value, Hash>>(MY_INGEST_LOCAL_TABLE_SIZE, true);
+        threads.emplace_back([&, t]()
+                             {
+            MyHashTable<Key, Value, Hash> &local_table = *tables[t];
+            uint64_t index = 0;
+            my_tokenize(text.substr(chunk_starts[t], chunk_starts[t + 1] - chunk_starts[t]), [&](std::string_view word)
+                        { local_table.insert(word, (Value)index++); });
+            word_counts[t] = index; });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    // Merge: the local indexes are shifted by the number of words of the previous chunks.
+    uint64_t offset = 0;
+    for (unsigned t = 0; t < thread_count; t++)
+    {
+        MyHashTable<Key, Value, Hash> &local_table = *tables[t];
+        for (auto *item = local_table.get_first(); item != nullptr; item = local_table.get_next(item))
+        {
+            table.insert(local_table.get_key(item), (Value)(offset + (uint64_t)item->value));
+        }
+        offset += word_counts[t];
+        tables[t].reset();
+    }
+    return offset;
+}
+
+#endif
@@ -1,13 +1,54 @@
 #include <iostream>
-#include <cpr/cpr.h>
 #include <sstream>
+#include <cpr/cpr.h>
 #include "my_hash_table.h"
+#include "my_mapped_file.h"
+#include "my_tokenizer.h"
 
 using namespace std;
 
 const string URL = "https://www.gutenberg.org/files/98/98-0.txt";
 const string START_PHRASE = "*** START OF THE PROJECT GUTENBERG EBOOK A TALE OF TWO CITIES ***";
 const unsigned long TABLE_SIZE = 50000;
+const bool TABLE_GROWABLE = false; // True: TABLE_SIZE is only the initial capacity, the hash table grows with its load factor
+const string BOOK_FILE = "";        // Not empty: read the book from this local file (memory-mapped) instead of downloading it
+const unsigned THREAD_COUNT = 0;    // Threads that split the words, 0: number of hardware threads
+
+/// @brief Save the hash table to a snapshot in memory and load it again. Also checks that load() rejects a snapshot
+/// whose header claims more slots than the stream holds, instead of allocating them.
+/// @param hash_table
+/// @return False if the loaded hash table differs or the corrupt snapshot was accepted.
+bool check_snapshot(MyHashTable<string, int, MyDjb2Hash> &hash_table)
+{
+    stringstream snapshot(ios::in | ios::out | ios::binary);
+    MyHashTable<string, int, MyDjb2Hash> loaded(MY_GROUP_WIDTH);
+    if (!hash_table.save(snapshot) || !loaded.load(snapshot) || loaded.get_count() != hash_table.get_count())
+    {
+        return false;
+    }
+    for (auto *item = hash_table.get_first(), *copy = loaded.get_first(); item != nullptr; item = hash_table.get_next(item), copy = loaded.get_next(copy))
+    {
+        if (copy == nullptr || hash_table.get_key(item) != loaded.get_key(copy) || item->value != copy->value)
+        {
+            return false;
+        }
+    }
+
+    // Corrupt header: 2^45 slots, the offsets behind them moved along, thus the header is consistent with itself.
+    string corrupt = snapshot.str();
+    MySnapshotHeader header;
+    memcpy(&header, corrupt.data(), sizeof(header));
+    uint64_t slot_count = (uint64_t)1 << 45;
+    uint64_t shift = my_snapshot_align((slot_count - header.slot_count) * (1 + sizeof(uint32_t)) + MY_SNAPSHOT_ALIGNMENT);
+    header.slot_count = slot_count;
+    header.slots_offset = my_snapshot_align(header.ctrl_offset + header.slot_count + header.group_width);
+    header.items_offset += shift;
+    header.key_arena_offset += shift;
+    header.file_size += shift;
+    memcpy(&corrupt[0], &header, sizeof(header));
+    stringstream corrupt_snapshot(corrupt, ios::in | ios::binary);
+    return !loaded.load(corrupt_snapshot) && loaded.get_count() == 0;
+}
 
 int main()
 {
@@ -23,32 +64,39 @@ int main()
     // --------------------------------------------------------------------------------------------------------
 
     cout << "--- Part 1 ---" << endl;
-    // Get the book as Response via HTTP-GET Request
-    cpr::Response r = cpr::Get(cpr::Url{URL});
-
-    // Get only the book's content
-    size_t start_index = r.text.find(START_PHRASE) + START_PHRASE.length();
-    string book_content = r.text.substr(start_index); // O(n), to be faster we could use a different data structure than string, e.g. Rope: https://en.wikipedia.org/wiki/Rope_(data_structure)
-
-    // Remove punctuation, O(n)
-    for (size_t i = 0; i < book_content.length(); i++)
+    // Get the book from a local file or as Response via HTTP-GET Request
+    MyMappedFile book_file;
+    cpr::Response r;
+    string_view book;
+    if (!BOOK_FILE.empty())
     {
-        if (iswpunct(book_content[i]))
+        if (!book_file.open(BOOK_FILE.c_str()))
         {
-            book_content[i] = ' '; // O(1)
+            cerr << "Cannot open " << BOOK_FILE << endl;
+            return 1;
         }
+        book = book_file.view();
     }
-
-    // Insert the book's content into the hash table
-    MyHashTable hash_table(TABLE_SIZE);
-    stringstream stream(book_content);
-    string word;
-    int i = 0;
-    while (stream >> word)
+    else
     {
-        hash_table.insert(word.data(), &i);
-        i++;
+        r = cpr::Get(cpr::Url{URL});
+        book = r.text;
     }
 
+    // Get only the book's content, O(1): a view instead of a copy
+    size_t start_index = book.find(START_PHRASE);
+    string_view book_content = start_index == string_view::npos ? book : book.substr(start_index + START_PHRASE.length());
+
+    // Insert the book's words into the hash table. Punctuation and whitespace separate the words, they are
+    // classified 16/32 bytes at once and the words are views into the book (see my_tokenizer.h).
+    MyHashTable<string, int, MyDjb2Hash> hash_table(TABLE_SIZE, TABLE_GROWABLE); // other hash policies: see my_hash_policies.h
+    my_ingest_words(book_content, hash_table, THREAD_COUNT);
+
     hash_table.print_all();
+
+    if (!check_snapshot(hash_table))
+    {
+        cerr << "Snapshot check failed" << endl;
+        return 1;
+    }
 }
@@ -0,0 +1,257 @@
+#include <iostream>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "my_decimal.h"
+
+using namespace std;
+
+// Local HTTP/1.1 server of GET /fapi/v1/aggTrades to measure the backfill without the exchange (and without its
+// rate limit). Every id has fixed trade data, thus any page can be served in any order and two runs return the
+// same bytes. Connections are kept alive like the API does.
+// Usage: mock_aggtrades_server [--port N] [--first-id ID] [--count N] [--latency MS] [--fail-every N]
+const char USAGE[] = "Usage: mock_aggtrades_server [--port N] [--first-id ID] [--count N] [--latency MS] [--fail-every N]";
+const int64_t BASE_TIME = 1728147158528; // timestamp of the first trade
+const int64_t TIME_STEP = 10;            // milliseconds between two trades
+const unsigned DEFAULT_LIMIT = 500;
+const unsigned MAX_LIMIT = 1000;
+const int WEIGHT = 20;
+const MyDecimalScale SCALE = {2, 3};
+
+unsigned long long first_id = 2353610640;
+unsigned long long trade_count = 10000000;
+int latency_ms = 0;       // delay of every response, e.g. to emulate the round trip to the exchange
+unsigned fail_every = 0; // every n-th request is answered with 429 Too Many Requests
+atomic<unsigned long long> request_count(0);
+atomic<int> used_weight(0);
+atomic<long long> weight_minute(0);
+
+uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+void append_number(string &text, unsigned long long value)
+{
+    char buffer[24];
+    text.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer);
+}
+
+void append_decimal(string &text, int64_t ticks, unsigned decimal_places)
+{
+    char buffer[MY_DECIMAL_BUFFER_SIZE];
+    text.append(buffer, my_format_decimal(ticks, decimal_places, buffer));
+}
+
+/// @brief Append the trades [from, to) in the layout of the API.
+void append_trades(string &json, unsigned long long from, unsigned long long to)
+{
+    json += '[';
+    for (unsigned long long id = from; id < to; id++)
+    {
+        uint64_t r = mix(id);
+        unsigned long long index = id - first_id;
+        json += id == from ? "{\"a\":" : ",{\"a\":";
+        append_number(json, id);
+        json += ",\"p\":\"";
+        append_decimal(json, 6203700 + (int64_t)(r % 2001) - 1000, SCALE.price);
+        json += "\",\"q\":\"";
+        append_decimal(json, 1 + (int64_t)((r >> 12) % 5000), SCALE.quantity);
+        json += "\",\"f\":";
+        append_number(json, 5445196068 + 2 * index);
+        json += ",\"l\":";
+        append_number(json, 5445196068 + 2 * index + (r >> 32) % 2);
+        json += ",\"T\":";
+        append_number(json, (unsigned long long)(BASE_TIME + (int64_t)index * TIME_STEP));
+        json += (r >> 40) % 2 == 0 ? ",\"m\":true}" : ",\"m\":false}";
+    }
+    json += ']';
+}
+
+/// @brief Get the value of a query parameter, empty if missing.
+string_view get_parameter(string_view target, string_view name)
+{
+    size_t query = target.find('?');
+    while (query != string_view::npos)
+    {
+        target.remove_prefix(query + 1);
+        size_t end = target.find('&');
+        string_view parameter = target.substr(0, end);
+        if (parameter.size() > name.size() && parameter.substr(0, name.size()) == name && parameter[name.size()] == '=')
+        {
+            return parameter.substr(name.size() + 1);
+        }
+        query = end;
+    }
+    return string_view();
+}
+
+unsigned long long to_number(string_view text, unsigned long long default_value)
+{
+    unsigned long long value;
+    return text.empty() || !my_parse_uint64(text, &value) ? default_value : value;
+}
+
+/// @brief Build the whole HTTP response to a request target, e.g. "/fapi/v1/aggTrades?symbol=BTCUSDT&fromId=1".
+string respond(string_view target)
+{
+    long long minute = chrono::duration_cast<chrono::minutes>(chrono::system_clock::now().time_since_epoch()).count();
+    if (weight_minute.exchange(minute) != minute)
+    {
+        used_weight = 0;
+    }
+    int weight = used_weight += WEIGHT;
+    unsigned long long request = ++request_count;
+
+    string body;
+    const char *status = "200 OK";
+    const char *extra_header = "";
+    if (target.substr(0, target.find('?')) != "/fapi/v1/aggTrades")
+    {
+        status = "404 Not Found";
+        body = "{\"code\":-1,\"msg\":\"Not found\"}";
+    }
+    else if (fail_every != 0 && request % fail_every == 0)
+    {
+        status = "429 Too Many Requests";
+        extra_header = "Retry-After: 1\r\n";
+        body = "{\"code\":-1003,\"msg\":\"Too many requests.\"}";
+    }
+    else
+    {
+        unsigned long long end_id = first_id + trade_count;
+        unsigned long long limit = min<unsigned long long>(to_number(get_parameter(target, "limit"), DEFAULT_LIMIT), MAX_LIMIT);
+        unsigned long long from = end_id - min(limit, trade_count); // the latest trades
+        if (!get_parameter(target, "fromId").empty())
+        {
+            from = max(to_number(get_parameter(target, "fromId"), 0), first_id);
+        }
+        else if (!get_parameter(target, "startTime").empty())
+        {
+            int64_t time = (int64_t)to_number(get_parameter(target, "startTime"), 0);
+            from = first_id + (unsigned long long)(max<int64_t>(time - BASE_TIME + TIME_STEP - 1, 0) / TIME_STEP);
+        }
+        from = min(from, end_id);
+        body.reserve(limit * 150 + 2);
+        append_trades(body, from, min(from + limit, end_id));
+    }
+
+    string response = "HTTP/1.1 ";
+    response += status;
+    response += "\r\nContent-Type: application/json\r\nConnection: keep-alive\r\nX-MBX-USED-WEIGHT-1M: ";
+    append_number(response, (unsigned long long)weight);
+    response += "\r\n";
+    response += extra_header;
+    response += "Content-Length: ";
+    append_number(response, body.size());
+    response += "\r\n\r\n";
+    response += body;
+    return response;
+}
+
+/// @brief Serve the requests of one connection until the client closes it.
+void serve(int client)
+{
+    string request;
+    char buffer[4096];
+    while (true)
+    {
+        size_t header_end;
+        while ((header_end = request.find("\r\n\r\n")) == string::npos)
+        {
+            ssize_t size = recv(client, buffer, sizeof(buffer), 0);
+            if (size <= 0)
+            {
+                close(client);
+                return;
+            }
+            request.append(buffer, (size_t)size);
+        }
+        // Request line: GET <target> HTTP/1.1, a GET has no body.
+        string_view line = string_view(request).substr(0, request.find("\r\n"));
+        size_t target_start = line.find(' ') + 1;
+        string_view target = line.substr(target_start, line.find(' ', target_start) - target_start);
+        if (latency_ms > 0)
+        {
+            this_thread::sleep_for(chrono::milliseconds(latency_ms));
+        }
+        string response = respond(target);
+        request.erase(0, header_end + 4);
+        for (size_t sent = 0; sent < response.size();)
+        {
+            ssize_t size = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (size <= 0)
+            {
+                close(client);
+                return;
+            }
+            sent += (size_t)size;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int port = 8080;
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            cerr << USAGE << endl;
+            return 1;
+        }
+        unsigned long long value = strtoull(argv[++i], nullptr, 10);
+        if (option == "--port")
+            port = (int)value;
+        else if (option == "--first-id")
+            first_id = value;
+        else if (option == "--count")
+            trade_count = value;
+        else if (option == "--latency")
+            latency_ms = (int)value;
+        else if (option == "--fail-every")
+            fail_every = (unsigned)value;
+        else
+        {
+            cerr << USAGE << endl;
+            return 1;
+        }
+    }
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t)port);
+    if (server < 0 || bind(server, (sockaddr *)&address, sizeof(address)) != 0 || listen(server, 64) != 0)
+    {
+        cerr << "Cannot listen on port " << port << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    cout << "Serving ids " << first_id << " to " << first_id + trade_count - 1 << " on http://127.0.0.1:" << port << endl;
+    while (true)
+    {
+        int client = accept(server, nullptr, nullptr);
+        if (client >= 0)
+        {
+            thread(serve, client).detach();
+        }
+    }
+}
@@ -0,0 +1,262 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "my_adaptive_parser.h"
+#include "my_aggtrade_capture.h"
+#include "my_aggtrade_generator.h"
+#include "my_aggtrade_parser.h"
+#include "my_aggtrade_stream_parser.h"
+#include "my_trade_aggregator.h"
+#include "my_trade_archive.h"
+#include "my_trade_buffer.h"
+#include "my_trade_formatter.h"
+
+using namespace std;
+
+// Throughput of the aggTrades parsers and formatters without network, reproducible run to run. The responses are replayed
+// from a capture file (part2 --record FILE) or generated with a fixed seed.
+// Usage: parser_bench [capture file]
+const size_t SYNTHETIC_RESPONSES = 200;
+const size_t SYNTHETIC_TRADES = 1000; // per response, the maximum of the API
+const size_t CHUNK_SIZES[] = {1024, 16384};
+const int REPEAT = 5; // the fastest run is reported
+const MyDecimalScale SCALE = {2, 3};
+const char ARCHIVE_FILE[] = "parser_bench.arc"; // written and removed again
+
+/// @brief A response and the chunks it arrived in.
+struct Response
+{
+    string json;
+    vector<size_t> chunk_sizes;
+};
+
+void split_chunks(Response &response, size_t chunk_size)
+{
+    response.chunk_sizes.clear();
+    for (size_t i = 0; i < response.json.size(); i += chunk_size)
+    {
+        response.chunk_sizes.push_back(min(chunk_size, response.json.size() - i));
+    }
+}
+
+/// @brief Discards the output, i.e. only the formatting is measured.
+class NullBuffer : public streambuf
+{
+protected:
+    streamsize xsputn(const char *, streamsize count) override { return count; }
+    int overflow(int c) override { return c; }
+};
+
+/// @brief Read all responses of a capture file, the chunks are kept as recorded.
+bool load_capture(const char *path, vector<Response> &responses)
+{
+    MyCaptureReplay replay;
+    if (!replay.open(path))
+    {
+        return false;
+    }
+    responses.emplace_back();
+    replay.replay([&](string_view chunk)
+                  { responses.back().json.append(chunk); responses.back().chunk_sizes.push_back(chunk.size()); return true; },
+                  [&]()
+                  { responses.emplace_back(); return true; });
+    responses.pop_back(); // an incomplete response at the end is ignored
+    return true;
+}
+
+/// @brief Run the operation REPEAT times over all responses, print the fastest run and return its number of trades.
+template <typename Operation>
+size_t measure(const char *name, const vector<Response> &responses, Operation operation)
+{
+    size_t bytes = 0;
+    for (const Response &response : responses)
+    {
+        bytes += response.json.size();
+    }
+    double best = 0;
+    size_t trade_count = 0;
+    for (int run = 0; run < REPEAT; run++)
+    {
+        trade_count = 0;
+        auto start = chrono::steady_clock::now();
+        for (const Response &response : responses)
+        {
+            trade_count += operation(response);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = run == 0 ? seconds : min(best, seconds);
+    }
+    cout << left << setw(30) << name << right << fixed << setprecision(1)
+         << setw(12) << best * 1e9 / max<size_t>(trade_count, 1) << setw(12) << bytes / best / 1e6
+         << setw(14) << setprecision(0) << trade_count / best << endl;
+    return trade_count;
+}
+
+int main(int argc, char *argv[])
+{
+    vector<Response> responses;
+    if (argc > 1)
+    {
+        if (!load_capture(argv[1], responses))
+        {
+            cerr << "Cannot read the capture file " << argv[1] << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        MyAggTradeGenerator generator;
+        responses.resize(SYNTHETIC_RESPONSES);
+        for (Response &response : responses)
+        {
+            response.json = generator.generate_response(SYNTHETIC_TRADES);
+        }
+    }
+
+    cout << "--- aggTrades parser benchmark: " << responses.size() << " responses (" << (argc > 1 ? argv[1] : "synthetic") << ") ---" << endl;
+    cout << left << setw(30) << "Parser" << right << setw(12) << "ns/trade" << setw(12) << "MB/s" << setw(14) << "trades/s" << endl;
+
+    MyTradeBuffer trades(SYNTHETIC_TRADES);
+    MyAggTradeParser parser;
+    MyAggTradeParser exact_parser(SCALE);
+    vector<size_t> counts;
+    counts.push_back(measure("index parser (double)", responses, [&](const Response &response)
+                             { trades.clear(); parser.parse(response.json, trades); return trades.size(); }));
+    counts.push_back(measure("index parser (exact)", responses, [&](const Response &response)
+                             { trades.clear(); exact_parser.parse(response.json, trades); return trades.size(); }));
+
+    // Adaptive parser: the responses as sent by the API take the fast path, the same responses with a space after
+    // every ':' and ',' take the general path.
+    MyAdaptiveAggTradeParser adaptive_parser(SCALE);
+    auto adaptive = [&](const Response &response)
+    { trades.clear(); adaptive_parser.parse(response.json, trades); return trades.size(); };
+    vector<Response> spaced(responses.size());
+    for (size_t i = 0; i < responses.size(); i++)
+    {
+        for (char c : responses[i].json)
+        {
+            spaced[i].json += c;
+            if (c == ':' || c == ',')
+            {
+                spaced[i].json += ' ';
+            }
+        }
+    }
+    counts.push_back(measure("adaptive parser (fast path)", responses, adaptive));
+    counts.push_back(measure("adaptive parser (general)", spaced, adaptive));
+
+    MyAggTradeStreamParser stream_parser(SCALE);
+    auto stream = [&](const Response &response)
+    {
+        trades.clear();
+        stream_parser.reset();
+        size_t offset = 0;
+        for (size_t chunk_size : response.chunk_sizes)
+        {
+            stream_parser.feed(string_view(response.json).substr(offset, chunk_size), [&](const AggTrade &trade)
+                               { trades.push_back(trade); });
+            offset += chunk_size;
+        }
+        return trades.size();
+    };
+    if (argc > 1)
+    {
+        counts.push_back(measure("stream parser (recorded)", responses, stream));
+    }
+    else
+    {
+        for (size_t chunk_size : CHUNK_SIZES)
+        {
+            for (Response &response : responses)
+            {
+                split_chunks(response, chunk_size);
+            }
+            string name = "stream parser (" + to_string(chunk_size / 1024) + " KB chunks)";
+            counts.push_back(measure(name.c_str(), responses, stream));
+        }
+    }
+
+    // Formatters: the parsed trades of every response are written to a stream that discards them.
+    vector<unique_ptr<MyTradeBuffer>> parsed;
+    for (const Response &response : responses)
+    {
+        parsed.push_back(make_unique<MyTradeBuffer>(SYNTHETIC_TRADES));
+        exact_parser.parse(response.json, *parsed.back());
+    }
+    NullBuffer null_buffer;
+    ostream null_stream(&null_buffer);
+    const pair<const char *, MyOutputFormat> FORMATS[] = {{"format pretty JSON (exact)", MY_FORMAT_PRETTY_JSON},
+                                                          {"format NDJSON (exact)", MY_FORMAT_NDJSON},
+                                                          {"format CSV (exact)", MY_FORMAT_CSV}};
+    for (const pair<const char *, MyOutputFormat> &format : FORMATS)
+    {
+        counts.push_back(measure(format.first, responses, [&](const Response &response)
+                                 {
+            MyTradeFormatter formatter(null_stream, format.second, SCALE);
+            formatter.write(*parsed[&response - responses.data()]);
+            return formatter.get_trade_count(); }));
+    }
+    counts.push_back(measure("format pretty JSON (double)", responses, [&](const Response &response)
+                             {
+        MyTradeFormatter formatter(null_stream, MY_FORMAT_PRETTY_JSON);
+        formatter.write(*parsed[&response - responses.data()]);
+        return formatter.get_trade_count(); }));
+
+    // Aggregation: bars and rolling totals of 2 time and 2 trade windows.
+    MyTradeAggregator aggregator({{MY_WINDOW_TIME, 1000}, {MY_WINDOW_TIME, 60000}, {MY_WINDOW_TRADES, 100}, {MY_WINDOW_TRADES, 1000}});
+    counts.push_back(measure("aggregate (4 windows)", responses, [&](const Response &response)
+                             {
+        const MyTradeBuffer &buffer = *parsed[&response - responses.data()];
+        aggregator.add(buffer);
+        return buffer.size(); }));
+
+    // Archive: size per trade and the time to load all trades again.
+    {
+        MyTradeArchiveWriter writer;
+        MyTradeArchiveReader reader;
+        size_t json_bytes = 0;
+        writer.open(ARCHIVE_FILE, SCALE);
+        for (size_t i = 0; i < responses.size(); i++)
+        {
+            writer.write(*parsed[i]);
+            json_bytes += responses[i].json.size();
+        }
+        if (!writer.close() || !reader.open(ARCHIVE_FILE))
+        {
+            cerr << "ERROR: Cannot write the archive " << ARCHIVE_FILE << endl;
+            return 1;
+        }
+        double load_best = 0;
+        size_t loaded = 0;
+        for (int run = 0; run < REPEAT; run++)
+        {
+            loaded = 0;
+            auto start = chrono::steady_clock::now();
+            for (size_t b = 0; b < reader.get_block_count(); b++)
+            {
+                reader.read_block(b, trades);
+                loaded += trades.size();
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            load_best = run == 0 ? seconds : min(load_best, seconds);
+        }
+        counts.push_back(loaded);
+        cout << left << setw(30) << "archive load" << right << fixed << setprecision(1) << setw(12) << load_best * 1e9 / max<size_t>(loaded, 1)
+             << setw(12) << reader.get_file_size() / load_best / 1e6 << setw(14) << setprecision(0) << loaded / load_best << endl;
+        cout << setprecision(1) << "archive size: " << (double)reader.get_file_size() / max<size_t>(loaded, 1) << " bytes per trade (JSON: "
+             << (double)json_bytes / max<size_t>(loaded, 1) << ")" << endl;
+    } // the archive is closed before it is removed
+    remove(ARCHIVE_FILE);
+
+    if (count(counts.begin(), counts.end(), counts[0]) != (long)counts.size())
+    {
+        cerr << "ERROR: The parsers and formatters disagree on the number of trades!" << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,375 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "my_aggtrade.h"
+#include "my_aggtrade_parser.h"
+#include "my_decimal.h"
+
+#ifndef __MY_ADAPTIVE_PARSER_H__
+#define __MY_ADAPTIVE_PARSER_H__
+
+/// @brief Maximum nesting of unknown values skipped by the general path.
+const int MY_ADAPTIVE_MAX_DEPTH = 64;
+
+/// @brief How often each path of MyAdaptiveAggTradeParser has run since the last reset.
+struct MyParsePathStats
+{
+    uint64_t fast_objects = 0;       // objects with the layout of the API, parsed at fixed offsets
+    uint64_t general_objects = 0;    // other objects: reordered keys, whitespace, extra fields
+    uint64_t empty_responses = 0;    // []
+    uint64_t error_responses = 0;    // {"code": ..., "msg": ...} instead of an array
+    uint64_t malformed_responses = 0; // invalid JSON or a trade without all its fields
+};
+
+/// @brief Parser of the aggTrades response that adapts to its layout object by object.
+/// @details Fast path: the API sends every object as {"a":1,"p":"2","q":"3","f":4,"l":5,"T":6,"m":true}. The
+/// fast path reads the values at the positions this layout gives them and compares the text between them (the
+/// keys) with a memcmp per key, thus the layout of every object is checked on the way at almost no cost. If an
+/// object does not match (reordered keys, whitespace, an added field), it is parsed again by the general path:
+/// key by key with whitespace, unknown keys and nested values skipped. A trade must have all 7 fields, otherwise
+/// the response is rejected instead of silently leaving a field 0. An empty array and an error object of the
+/// API are recognized and counted.
+class MyAdaptiveAggTradeParser
+{
+private:
+    MyDecimalScale scale = {0, 0};
+    bool exact = false;
+    MyParsePathStats stats;
+    long long error_code = 0;
+    std::string error_message;
+
+    static bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+    static void skip_space(const char *&p, const char *end)
+    {
+        while (p < end && is_space(*p))
+        {
+            p++;
+        }
+    }
+
+    /// @brief Consume a literal, e.g. a key with its quotes and colon.
+    static bool expect(const char *&p, const char *end, std::string_view literal)
+    {
+        if ((size_t)(end - p) < literal.size() || memcmp(p, literal.data(), literal.size()) != 0)
+        {
+            return false;
+        }
+        p += literal.size();
+        return true;
+    }
+
+    static std::string_view take_digits(const char *&p, const char *end)
+    {
+        const char *start = p;
+        while (p < end && is_digit(*p))
+        {
+            p++;
+        }
+        return std::string_view(start, (size_t)(p - start));
+    }
+
+    /// @brief Take the text up to the closing quote of a string without escapes, p must be behind the opening quote.
+    static bool take_plain_string(const char *&p, const char *end, std::string_view &value)
+    {
+        const char *start = p;
+        while (p < end && *p != '"' && *p != '\\')
+        {
+            p++;
+        }
+        if (p == end || *p != '"')
+        {
+            return false;
+        }
+        value = std::string_view(start, (size_t)(p - start));
+        p++;
+        return true;
+    }
+
+    /// @brief Take a string with escapes, p must be at the opening quote. value is the raw text between the quotes.
+    static bool take_string(const char *&p, const char *end, std::string_view &value)
+    {
+        const char *start = ++p;
+        while (p < end && *p != '"')
+        {
+            p += *p == '\\' ? 2 : 1;
+        }
+        if (p >= end)
+        {
+            return false;
+        }
+        value = std::string_view(start, (size_t)(p - start));
+        p++;
+        return true;
+    }
+
+    /// @brief Take any JSON value. Objects and arrays are skipped as a whole, value is their raw text.
+    /// @param quoted Set if the value is a string, value is then the text between the quotes.
+    static bool take_value(const char *&p, const char *end, std::string_view &value, bool &quoted)
+    {
+        quoted = p < end && *p == '"';
+        if (quoted)
+        {
+            return take_string(p, end, value);
+        }
+        const char *start = p;
+        if (p < end && (*p == '{' || *p == '['))
+        {
+            int depth = 0;
+            do
+            {
+                if (*p == '"')
+                {
+                    std::string_view skipped;
+                    if (!take_string(p, end, skipped))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+                depth += *p == '{' || *p == '[' ? 1 : (*p == '}' || *p == ']' ? -1 : 0);
+                if (depth > MY_ADAPTIVE_MAX_DEPTH)
+                {
+                    return false;
+                }
+                p++;
+            } while (depth > 0 && p < end);
+            value = std::string_view(start, (size_t)(p - start));
+            return depth == 0;
+        }
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && !is_space(*p))
+        {
+            p++;
+        }
+        value = std::string_view(start, (size_t)(p - start));
+        return !value.empty();
+    }
+
+    /// @brief Parse {"key": value, ...} and call on_value(key, value, quoted) for every key.
+    /// @param p In: the '{'. Out: behind the '}'.
+    template <typename OnValue>
+    static bool parse_object(const char *&p, const char *end, OnValue on_value)
+    {
+        if (!expect(p, end, "{"))
+        {
+            return false;
+        }
+        skip_space(p, end);
+        if (expect(p, end, "}"))
+        {
+            return true;
+        }
+        while (true)
+        {
+            std::string_view key;
+            std::string_view value;
+            bool quoted;
+            if (p == end || *p != '"' || !take_string(p, end, key))
+            {
+                return false;
+            }
+            skip_space(p, end);
+            if (!expect(p, end, ":"))
+            {
+                return false;
+            }
+            skip_space(p, end);
+            if (!take_value(p, end, value, quoted) || !on_value(key, value, quoted))
+            {
+                return false;
+            }
+            skip_space(p, end);
+            if (expect(p, end, "}"))
+            {
+                return true;
+            }
+            if (!expect(p, end, ","))
+            {
+                return false;
+            }
+            skip_space(p, end);
+        }
+    }
+
+    bool decode(std::string_view key, std::string_view value, AggTrade &trade)
+    {
+        return my_decode_aggtrade_value(key, value, this->exact ? &this->scale : nullptr, &trade);
+    }
+
+    /// @brief Parse an object with the layout of the API.
+    /// @return False if the object has another layout (nothing is consumed then) or a value is invalid.
+    bool parse_fast(const char *&position, const char *end, AggTrade &trade)
+    {
+        const char *p = position;
+        std::string_view value;
+        if (!expect(p, end, "{\"a\":") || !decode("a", take_digits(p, end), trade) ||
+            !expect(p, end, ",\"p\":\"") || !take_plain_string(p, end, value) || !decode("p", value, trade) ||
+            !expect(p, end, ",\"q\":\"") || !take_plain_string(p, end, value) || !decode("q", value, trade) ||
+            !expect(p, end, ",\"f\":") || !decode("f", take_digits(p, end), trade) ||
+            !expect(p, end, ",\"l\":") || !decode("l", take_digits(p, end), trade) ||
+            !expect(p, end, ",\"T\":") || !decode("T", take_digits(p, end), trade) ||
+            !expect(p, end, ",\"m\":"))
+        {
+            return false;
+        }
+        if (expect(p, end, "true}"))
+        {
+            trade.BuyerIsMaker = true;
+        }
+        else if (expect(p, end, "false}"))
+        {
+            trade.BuyerIsMaker = false;
+        }
+        else
+        {
+            return false;
+        }
+        position = p;
+        return true;
+    }
+
+    /// @brief Parse an object with any layout, all 7 fields are required.
+    bool parse_general(const char *&p, const char *end, AggTrade &trade)
+    {
+        unsigned keys = 0;
+        bool ok = parse_object(p, end, [&](std::string_view key, std::string_view value, bool quoted)
+                               {
+            unsigned bit = my_aggtrade_key_bit(key);
+            if (bit == 0)
+            {
+                return true; // unknown field
+            }
+            // Numbers and booleans must not be quoted, price and quantity must be.
+            bool string_key = key[0] == 'p' || key[0] == 'q';
+            keys |= bit;
+            return quoted == string_key && decode(key, value, trade); });
+        return ok && keys == MY_AGGTRADE_ALL_KEYS;
+    }
+
+    /// @brief Parse an error object of the API: {"code": -1121, "msg": "Invalid symbol."}.
+    bool parse_error(const char *&p, const char *end)
+    {
+        this->error_code = 0;
+        this->error_message.clear();
+        bool ok = parse_object(p, end, [&](std::string_view key, std::string_view value, bool quoted)
+                               {
+            if (key == "code" && !quoted)
+            {
+                this->error_code = strtoll(std::string(value).c_str(), nullptr, 10);
+            }
+            else if (key == "msg" && quoted)
+            {
+                this->error_message = std::string(value);
+            }
+            return true; });
+        return ok;
+    }
+
+public:
+    /// @brief Parser that decodes price and quantity as double only (PriceTicks and QuantityTicks stay 0).
+    MyAdaptiveAggTradeParser() = default;
+
+    /// @brief Parser that decodes price and quantity exactly into ticks, see MyAggTradeParser.
+    /// @param scale Decimal places of the symbol.
+    explicit MyAdaptiveAggTradeParser(MyDecimalScale scale) : scale(scale), exact(true) {}
+
+    /// @brief Parse the trades of a response.
+    /// @tparam Trades E.g. MyTradeBuffer or std::vector<AggTrade>, needs push_back(const AggTrade &).
+    /// @param json JSON array of aggTrade objects, or an error object of the API.
+    /// @param trades The trades are appended.
+    /// @return False if the response is an error object (see get_error_code()) or malformed, the trades before the
+    /// error have been appended.
+    template <typename Trades>
+    bool parse(std::string_view json, Trades &trades)
+    {
+        const char *p = json.data();
+        const char *end = p + json.size();
+        skip_space(p, end);
+        if (p < end && *p == '{')
+        {
+            bool ok = parse_error(p, end);
+            skip_space(p, end);
+            if (ok && p == end)
+            {
+                this->stats.error_responses++;
+            }
+            else
+            {
+                this->stats.malformed_responses++;
+            }
+            return false;
+        }
+        if (!expect(p, end, "["))
+        {
+            this->stats.malformed_responses++;
+            return false;
+        }
+        skip_space(p, end);
+        if (expect(p, end, "]"))
+        {
+            skip_space(p, end);
+            if (p != end)
+            {
+                this->stats.malformed_responses++;
+                return false;
+            }
+            this->stats.empty_responses++;
+            return true;
+        }
+        AggTrade trade;
+        while (true)
+        {
+            trade = {};
+            if (parse_fast(p, end, trade))
+            {
+                this->stats.fast_objects++;
+            }
+            else
+            {
+                trade = {};
+                skip_space(p, end);
+                if (!parse_general(p, end, trade))
+                {
+                    this->stats.malformed_responses++;
+                    return false;
+                }
+                this->stats.general_objects++;
+            }
+            trades.push_back(trade);
+            if (p < end && *p == ',')
+            {
+                p++;
+                continue;
+            }
+            skip_space(p, end);
+            if (expect(p, end, ","))
+            {
+                skip_space(p, end);
+                continue;
+            }
+            if (expect(p, end, "]"))
+            {
+                skip_space(p, end);
+                if (p != end)
+                {
+                    this->stats.malformed_responses++;
+                }
+                return p == end;
+            }
+            this->stats.malformed_responses++;
+            return false;
+        }
+    }
+
+    const MyParsePathStats &get_stats() const { return this->stats; }
+    void reset_stats() { this->stats = MyParsePathStats(); }
+
+    /// @brief Code of the last error object, e.g. -1121 for an invalid symbol.
+    long long get_error_code() const { return this->error_code; }
+    const std::string &get_error_message() const { return this->error_message; }
+};
+
+#endif
@@ -0,0 +1,24 @@
+#include <cstdint>
+#include <ctime>
+
+#ifndef __MY_AGGTRADE_H__
+#define __MY_AGGTRADE_H__
+
+/// @brief Aggregate trade of GET /fapi/v1/aggTrades.
+typedef struct AggTrade
+{
+    unsigned long long AggregateTradeId;
+    double Price;
+    double Quantity;
+    unsigned long long FirstTrade;
+    unsigned long long LastTrade;
+    time_t Timestamp;
+    bool BuyerIsMaker;
+    /// @brief Exact price in ticks of 10^-MyDecimalScale::price, only set if MyAggTradeParser has a scale.
+    int64_t PriceTicks;
+    /// @brief Exact quantity in ticks of 10^-MyDecimalScale::quantity, only set if MyAggTradeParser has a scale.
+    int64_t QuantityTicks;
+
+} AggTrade;
+
+#endif
@@ -0,0 +1,196 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <thread>
+#include "my_mapped_file.h"
+
+#ifndef __MY_AGGTRADE_CAPTURE_H__
+#define __MY_AGGTRADE_CAPTURE_H__
+
+// -----------------------------------------------------------
+// Capture file: the raw bytes of HTTP responses as they arrived, chunk by chunk and with their arrival time,
+// to replay them byte for byte without network. Layout (byte order of the machine that wrote it):
+// MyCaptureHeader, then per chunk a MyFrameHeader followed by size bytes, and a MY_FRAME_END frame per response.
+// -----------------------------------------------------------
+
+const char MY_CAPTURE_MAGIC[8] = {'M', 'Y', 'A', 'G', 'G', 'C', 'A', 'P'};
+/// @brief Increased whenever the layout changes, files of other versions are rejected.
+const uint32_t MY_CAPTURE_VERSION = 1;
+
+/// @brief Type of a frame of a capture file.
+enum MyFrameType : uint32_t
+{
+    MY_FRAME_CHUNK = 0, // bytes of the response body
+    MY_FRAME_END = 1    // the response is complete, no bytes
+};
+
+struct MyCaptureHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    /// @brief Start of the capture in nanoseconds since the epoch (system clock).
+    int64_t start_time;
+};
+
+struct MyFrameHeader
+{
+    /// @brief Arrival in nanoseconds since the start of the capture.
+    int64_t time;
+    uint32_t type;
+    uint32_t size;
+};
+
+/// @brief Records responses into a capture file, e.g. from the write callback of cpr.
+class MyCaptureWriter
+{
+private:
+    std::ofstream file;
+    std::chrono::steady_clock::time_point start;
+
+    void write_frame(MyFrameType type, std::string_view data)
+    {
+        MyFrameHeader frame;
+        frame.time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start).count();
+        frame.type = type;
+        frame.size = (uint32_t)data.size();
+        this->file.write((const char *)&frame, sizeof(frame));
+        this->file.write(data.data(), (std::streamsize)data.size());
+    }
+
+public:
+    /// @brief Create or overwrite a capture file.
+    /// @param path
+    /// @return False if the file cannot be written.
+    bool open(const char *path)
+    {
+        this->file.open(path, std::ios::binary | std::ios::trunc);
+        this->start = std::chrono::steady_clock::now();
+        MyCaptureHeader header = {};
+        memcpy(header.magic, MY_CAPTURE_MAGIC, sizeof(header.magic));
+        header.version = MY_CAPTURE_VERSION;
+        header.start_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        this->file.write((const char *)&header, sizeof(header));
+        return this->file.good();
+    }
+
+    /// @brief Record the next chunk of the current response, chunks larger than 4 GB are split.
+    void write_chunk(std::string_view chunk)
+    {
+        do
+        {
+            std::string_view part = chunk.substr(0, UINT32_MAX);
+            write_frame(MY_FRAME_CHUNK, part);
+            chunk.remove_prefix(part.size());
+        } while (!chunk.empty());
+    }
+
+    /// @brief Mark the current response as complete, the next chunk starts a new response.
+    void end_response() { write_frame(MY_FRAME_END, std::string_view()); }
+
+    /// @brief Flush and close the file.
+    /// @return False if any write failed.
+    bool close()
+    {
+        this->file.close();
+        return !this->file.fail();
+    }
+
+    bool is_open() { return this->file.is_open(); }
+};
+
+/// @brief Replays a capture file from a memory mapping: the chunks are passed on where they are in the file.
+class MyCaptureReplay
+{
+private:
+    MyMappedFile file;
+    MyCaptureHeader header = {};
+    size_t response_count = 0;
+    size_t chunk_count = 0;
+    size_t byte_count = 0;
+
+public:
+    /// @brief Map a capture file and check all frame headers.
+    /// @param path
+    /// @return False if the file cannot be mapped, is of another version, is truncated or has unknown frames.
+    bool open(const char *path)
+    {
+        this->response_count = this->chunk_count = this->byte_count = 0;
+        if (!this->file.open(path) || this->file.get_size() < sizeof(MyCaptureHeader))
+        {
+            this->file.close();
+            return false;
+        }
+        memcpy(&this->header, this->file.get_data(), sizeof(this->header));
+        if (memcmp(this->header.magic, MY_CAPTURE_MAGIC, sizeof(MY_CAPTURE_MAGIC)) != 0 || this->header.version != MY_CAPTURE_VERSION)
+        {
+            this->file.close();
+            return false;
+        }
+        for (size_t offset = sizeof(MyCaptureHeader); offset < this->file.get_size();)
+        {
+            MyFrameHeader frame;
+            if (this->file.get_size() - offset < sizeof(frame))
+            {
+                this->file.close();
+                return false;
+            }
+            memcpy(&frame, this->file.get_data() + offset, sizeof(frame));
+            offset += sizeof(frame);
+            if (this->file.get_size() - offset < frame.size || (frame.type != MY_FRAME_CHUNK && frame.type != MY_FRAME_END))
+            {
+                this->file.close();
+                return false;
+            }
+            offset += frame.size;
+            this->chunk_count += frame.type == MY_FRAME_CHUNK;
+            this->response_count += frame.type == MY_FRAME_END;
+            this->byte_count += frame.size;
+        }
+        return true;
+    }
+
+    /// @brief Pass all frames on in the recorded order.
+    /// @param on_chunk Called with std::string_view for every chunk (valid while the capture is open), returns
+    /// false to stop the replay.
+    /// @param on_end Called at the end of every response, returns false to stop the replay.
+    /// @param paced False: as fast as possible. True: every frame is passed on at its recorded time after the
+    /// start of the replay, i.e. at the original pacing of the network.
+    /// @return False if the replay has been stopped or no capture is open.
+    template <typename OnChunk, typename OnEnd>
+    bool replay(OnChunk on_chunk, OnEnd on_end, bool paced = false)
+    {
+        if (this->file.get_data() == nullptr)
+        {
+            return false;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t offset = sizeof(MyCaptureHeader); offset < this->file.get_size();)
+        {
+            MyFrameHeader frame;
+            memcpy(&frame, this->file.get_data() + offset, sizeof(frame));
+            offset += sizeof(frame);
+            if (paced)
+            {
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(frame.time));
+            }
+            bool proceed = frame.type == MY_FRAME_END ? on_end() : on_chunk(std::string_view(this->file.get_data() + offset, frame.size));
+            if (!proceed)
+            {
+                return false;
+            }
+            offset += frame.size;
+        }
+        return true;
+    }
+
+    size_t get_response_count() { return this->response_count; }
+    size_t get_chunk_count() { return this->chunk_count; }
+    size_t get_byte_count() { return this->byte_count; }
+    /// @brief Start of the capture in nanoseconds since the epoch.
+    int64_t get_start_time() { return this->header.start_time; }
+};
+
+#endif
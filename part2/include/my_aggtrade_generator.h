@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <random>
+#include <string>
+#include "my_decimal.h"
+
+#ifndef __MY_AGGTRADE_GENERATOR_H__
+#define __MY_AGGTRADE_GENERATOR_H__
+
+/// @brief Generates valid responses of GET /fapi/v1/aggTrades of any size, e.g. to measure the parsers offline.
+/// @details Same layout as the API (compact JSON, keys a, p, q, f, l, T, m). The price is a random walk in ticks,
+/// ids and timestamps increase from response to response like a real feed. The same seed gives the same bytes.
+class MyAggTradeGenerator
+{
+private:
+    std::mt19937_64 random;
+    MyDecimalScale scale;
+    unsigned long long next_id = 2353610640;
+    unsigned long long next_trade_id = 5445196068;
+    long long timestamp = 1728147158528;
+    int64_t price_ticks;
+
+    void append_number(std::string &json, unsigned long long value)
+    {
+        char buffer[24];
+        json.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer);
+    }
+
+    void append_decimal(std::string &json, int64_t ticks, unsigned int decimal_places)
+    {
+        char buffer[MY_DECIMAL_BUFFER_SIZE];
+        json.append(buffer, my_format_decimal(ticks, decimal_places, buffer));
+    }
+
+public:
+    /// @brief Constructor
+    /// @param seed
+    /// @param scale Decimal places of price and quantity, see MyDecimalScale.
+    explicit MyAggTradeGenerator(uint64_t seed = 42, MyDecimalScale scale = {2, 3})
+        : random(seed), scale(scale), price_ticks(62037 * MY_POW10[scale.price]) {}
+
+    /// @brief Append one response with the given number of trades.
+    void append_response(std::string &json, size_t count)
+    {
+        json += '[';
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t r = this->random();
+            // Small steps of the price, mostly small quantities with a few large ones.
+            this->price_ticks = std::max<int64_t>(1, this->price_ticks + (int64_t)(r % 21) - 10);
+            int64_t quantity_ticks = 1 + (int64_t)((r >> 8) % 1000) * ((r >> 20) % 16 == 0 ? 100 : 1);
+            unsigned long long trade_count = 1 + (r >> 24) % 4;
+            json += i == 0 ? "{\"a\":" : ",{\"a\":";
+            append_number(json, this->next_id++);
+            json += ",\"p\":\"";
+            append_decimal(json, this->price_ticks, this->scale.price);
+            json += "\",\"q\":\"";
+            append_decimal(json, quantity_ticks, this->scale.quantity);
+            json += "\",\"f\":";
+            append_number(json, this->next_trade_id);
+            json += ",\"l\":";
+            append_number(json, this->next_trade_id + trade_count - 1);
+            json += ",\"T\":";
+            append_number(json, (unsigned long long)this->timestamp);
+            json += (r >> 32) % 2 == 0 ? ",\"m\":true}" : ",\"m\":false}";
+            this->next_trade_id += trade_count;
+            this->timestamp += (long long)((r >> 40) % 50);
+        }
+        json += ']';
+    }
+
+    /// @brief Get one response with the given number of trades.
+    std::string generate_response(size_t count)
+    {
+        std::string json;
+        json.reserve(count * 150 + 2);
+        append_response(json, count);
+        return json;
+    }
+};
+
+#endif
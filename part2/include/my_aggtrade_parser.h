@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include "my_aggtrade.h"
+#include "my_decimal.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MY_JSON_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MY_JSON_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifndef __MY_AGGTRADE_PARSER_H__
+#define __MY_AGGTRADE_PARSER_H__
+
+// -----------------------------------------------------------
+// Parser in two stages like simdjson (https://arxiv.org/abs/1902.08318):
+// 1. Structural index: the positions of all quotes and of {}[]:, outside of strings, found 64 bytes at once.
+// 2. Walk the index: every key and value is located by the index and decoded directly from the JSON.
+// -----------------------------------------------------------
+
+/// @brief Number of bytes classified at once by stage 1.
+const size_t MY_JSON_BLOCK_SIZE = 64;
+
+/// @brief Index of the lowest set bit, mask must not be 0.
+inline unsigned int my_json_lowest_bit(uint64_t mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, (unsigned long)mask))
+    {
+        return index;
+    }
+    _BitScanForward(&index, (unsigned long)(mask >> 32));
+    return 32 + index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/// @brief Number of set bits.
+inline size_t my_json_popcount(uint64_t mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (size_t)__popcnt64(mask);
+#elif defined(_MSC_VER)
+    return (size_t)(__popcnt((unsigned int)mask) + __popcnt((unsigned int)(mask >> 32)));
+#else
+    return (size_t)__builtin_popcountll(mask);
+#endif
+}
+
+/// @brief Prefix XOR: bit i of the result is the XOR of the bits 0..i of the mask.
+/// @details Turns the mask of quotes into the mask of the bytes inside strings (opening quote included).
+inline uint64_t my_prefix_xor(uint64_t mask)
+{
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+}
+
+/// @brief 64 bytes of JSON loaded into SIMD registers, compared with one character at a time.
+struct MyJsonBlock
+{
+#if defined(MY_JSON_AVX2)
+    __m256i chunks[2];
+#elif defined(MY_JSON_SSE2)
+    __m128i chunks[4];
+#else
+    const char *data;
+#endif
+
+    explicit MyJsonBlock(const char *data)
+    {
+#if defined(MY_JSON_AVX2)
+        this->chunks[0] = _mm256_loadu_si256((const __m256i *)data);
+        this->chunks[1] = _mm256_loadu_si256((const __m256i *)(data + 32));
+#elif defined(MY_JSON_SSE2)
+        for (int i = 0; i < 4; i++)
+        {
+            this->chunks[i] = _mm_loadu_si128((const __m128i *)(data + 16 * i));
+        }
+#else
+        this->data = data;
+#endif
+    }
+
+    /// @brief Get the bytes that equal c, bit i = byte i.
+    uint64_t eq(char c) const
+    {
+#if defined(MY_JSON_AVX2)
+        __m256i value = _mm256_set1_epi8(c);
+        return (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(this->chunks[0], value)) |
+               ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(this->chunks[1], value)) << 32);
+#elif defined(MY_JSON_SSE2)
+        __m128i value = _mm_set1_epi8(c);
+        uint64_t mask = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(this->chunks[i], value)) << (16 * i);
+        }
+        return mask;
+#else
+        uint64_t mask = 0;
+        for (size_t i = 0; i < MY_JSON_BLOCK_SIZE; i++)
+        {
+            mask |= (uint64_t)(this->data[i] == c) << i;
+        }
+        return mask;
+#endif
+    }
+
+    /// @brief Get the bytes that are one of {}[]:, (strings are not excluded), the comparisons are combined before
+    /// the mask is extracted. '[' and ']' differ from '{' and '}' only in bit 0x20, thus 4 comparisons suffice.
+    uint64_t operators() const
+    {
+#if defined(MY_JSON_AVX2)
+        uint64_t mask = 0;
+        for (int i = 0; i < 2; i++)
+        {
+            __m256i folded = _mm256_or_si256(this->chunks[i], _mm256_set1_epi8(0x20));
+            __m256i matches = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(this->chunks[i], _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(this->chunks[i], _mm256_set1_epi8(','))));
+            mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(matches) << (32 * i);
+        }
+        return mask;
+#elif defined(MY_JSON_SSE2)
+        uint64_t mask = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            __m128i folded = _mm_or_si128(this->chunks[i], _mm_set1_epi8(0x20));
+            __m128i matches = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                _mm_or_si128(_mm_cmpeq_epi8(this->chunks[i], _mm_set1_epi8(':')), _mm_cmpeq_epi8(this->chunks[i], _mm_set1_epi8(','))));
+            mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(matches) << (16 * i);
+        }
+        return mask;
+#else
+        return eq('{') | eq('}') | eq('[') | eq(']') | eq(':') | eq(',');
+#endif
+    }
+};
+
+/// @brief Find the characters escaped by a backslash (simdjson's escape scanner).
+/// @param backslashes Backslashes of the block.
+/// @param prev_escaped In: whether the first byte of the block is escaped. Out: the same for the next block.
+/// @return Bit i is set if byte i is escaped.
+inline uint64_t my_find_escaped(uint64_t backslashes, uint64_t *prev_escaped)
+{
+    const uint64_t even_bits = 0x5555555555555555ull;
+    backslashes &= ~*prev_escaped;
+    uint64_t follows_escape = (backslashes << 1) | *prev_escaped;
+    // Sequences of backslashes that start on an odd bit are flipped by the addition below.
+    uint64_t odd_sequence_starts = backslashes & ~even_bits & ~follows_escape;
+    uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslashes;
+    *prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts; // carry
+    uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+/// @brief Stage 1: find the positions of all unescaped quotes and of the characters {}[]:, outside of strings.
+/// @param json
+/// @param index Replaced with the positions in ascending order. Reused to avoid allocations.
+/// @return False if the JSON ends inside a string or is larger than 4 GB.
+inline bool my_build_structural_index(std::string_view json, std::vector<uint32_t> &index)
+{
+    if (json.size() >= UINT32_MAX)
+    {
+        return false;
+    }
+    size_t written = 0;
+    uint64_t prev_escaped = 0;
+    uint64_t prev_in_string = 0; // all bits set if the previous block ended inside a string
+    char tail[MY_JSON_BLOCK_SIZE];
+    for (size_t block = 0; block < json.size(); block += MY_JSON_BLOCK_SIZE)
+    {
+        const char *data = json.data() + block;
+        if (block + MY_JSON_BLOCK_SIZE > json.size())
+        {
+            // The last block is padded with spaces, so that no byte behind the JSON is read.
+            memset(tail, ' ', MY_JSON_BLOCK_SIZE);
+            memcpy(tail, data, json.size() - block);
+            data = tail;
+        }
+        MyJsonBlock bytes(data);
+        uint64_t quotes = bytes.eq('"') & ~my_find_escaped(bytes.eq('\\'), &prev_escaped);
+        uint64_t in_string = my_prefix_xor(quotes) ^ prev_in_string;
+        prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+        uint64_t operators = bytes.operators();
+        uint64_t structurals = (operators & ~in_string) | quotes;
+
+        if (index.size() < written + MY_JSON_BLOCK_SIZE)
+        {
+            index.resize(std::max(2 * index.size(), written + MY_JSON_BLOCK_SIZE));
+        }
+        // Flatten the bits 4 at a time without a branch per bit, surplus positions are overwritten by the next block.
+        uint32_t *out = index.data() + written;
+        size_t count = my_json_popcount(structurals);
+        for (size_t i = 0; i < count; i += 4)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                out[i + j] = (uint32_t)(block + my_json_lowest_bit(structurals | (1ull << 63)));
+                structurals &= structurals - 1;
+            }
+        }
+        written += count;
+    }
+    index.resize(written);
+    return prev_in_string == 0;
+}
+
+/// @brief Parse a floating point number, the whole text must be a number.
+inline bool my_parse_double(std::string_view text, double *value)
+{
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), *value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+/// @brief Remove JSON whitespace around a scalar value.
+inline std::string_view my_json_trim(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\n' || text.front() == '\r' || text.front() == '\t'))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\n' || text.back() == '\r' || text.back() == '\t'))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+/// @brief Decode the value of a key of an aggTrade object into the trade.
+/// @param key E.g. "p", other keys than a, p, q, f, l, T and m are ignored.
+/// @param value The value without quotes.
+/// @param scale Decimal places of price and quantity to decode them exactly, nullptr: as double only.
+/// @param trade
+/// @return False if the value is not valid for its key.
+inline bool my_decode_aggtrade_value(std::string_view key, std::string_view value, const MyDecimalScale *scale, AggTrade *trade)
+{
+    if (key.size() != 1)
+    {
+        return true; // unknown key
+    }
+    unsigned long long number;
+    switch (key[0])
+    {
+    case 'a':
+        return my_parse_uint64(value, &trade->AggregateTradeId);
+    case 'p':
+        if (scale == nullptr)
+        {
+            return my_parse_double(value, &trade->Price);
+        }
+        if (!my_parse_decimal(value, scale->price, &trade->PriceTicks))
+        {
+            return false;
+        }
+        trade->Price = my_decimal_to_double(trade->PriceTicks, scale->price);
+        return true;
+    case 'q':
+        if (scale == nullptr)
+        {
+            return my_parse_double(value, &trade->Quantity);
+        }
+        if (!my_parse_decimal(value, scale->quantity, &trade->QuantityTicks))
+        {
+            return false;
+        }
+        trade->Quantity = my_decimal_to_double(trade->QuantityTicks, scale->quantity);
+        return true;
+    case 'f':
+        return my_parse_uint64(value, &trade->FirstTrade);
+    case 'l':
+        return my_parse_uint64(value, &trade->LastTrade);
+    case 'T':
+        if (!my_parse_uint64(value, &number))
+        {
+            return false;
+        }
+        trade->Timestamp = (time_t)number;
+        return true;
+    case 'm':
+        trade->BuyerIsMaker = value == "true";
+        return value == "true" || value == "false";
+    default:
+        return true; // unknown key
+    }
+}
+
+/// @brief Bits of the keys every aggTrade object must have, see my_aggtrade_key_bit().
+const unsigned MY_AGGTRADE_ALL_KEYS = 0x7F;
+
+/// @brief Get the bit of a key of an aggTrade object: a, p, q, f, l, T, m are bit 0 to 6.
+/// @return 0 for an unknown key.
+inline unsigned my_aggtrade_key_bit(std::string_view key)
+{
+    size_t bit = key.size() == 1 ? std::string_view("apqflTm").find(key[0]) : std::string_view::npos;
+    return bit == std::string_view::npos ? 0 : 1u << bit;
+}
+
+/// @brief Result of parsing (a part of) the array of trades.
+enum MyParseStatus
+{
+    MY_PARSE_OK,         // the array is complete
+    MY_PARSE_INCOMPLETE, // more data is needed, e.g. the response was cut in the middle of a trade
+    MY_PARSE_ERROR       // the JSON is malformed
+};
+
+/// @brief Where a resumable parse is in the array of trades.
+enum MyArrayState
+{
+    MY_ARRAY_START, // expecting '['
+    MY_ARRAY_FIRST, // expecting the first trade or ']'
+    MY_ARRAY_NEXT,  // expecting ',' or ']'
+    MY_ARRAY_END    // ']' has been parsed
+};
+
+/// @brief Parser of the JSON array of GET /fapi/v1/aggTrades using a structural index.
+/// @details Keys may come in any order and unknown keys are skipped, whitespace is allowed. A trade must have all
+/// 7 keys, otherwise the JSON is malformed instead of a trade with fields of 0 being passed on. No string is
+/// copied: every value is decoded from a std::string_view into the response. The index is kept between
+/// calls, thus parsing many responses does not allocate once the buffers are large enough.
+class MyAggTradeParser
+{
+private:
+    std::vector<uint32_t> index;
+    /// @brief Decimal places of price and quantity, only used if exact is true.
+    MyDecimalScale scale = {0, 0};
+    bool exact = false;
+
+    /// @brief Decode the value of a key into the trade.
+    bool decode(std::string_view key, std::string_view value, AggTrade *trade)
+    {
+        return my_decode_aggtrade_value(key, value, this->exact ? &this->scale : nullptr, trade);
+    }
+
+    /// @brief Parse one object: {"key": value, ...}.
+    /// @param text
+    /// @param position In: the '{'. Out: behind the '}' if the object is complete.
+    /// @param end End of the structural index.
+    /// @param trade
+    MyParseStatus parse_object(const char *text, const uint32_t *&position, const uint32_t *end, AggTrade &trade)
+    {
+        trade = {};
+        if (++position == end)
+        {
+            return MY_PARSE_INCOMPLETE;
+        }
+        if (text[*position] == '}')
+        {
+            return MY_PARSE_ERROR; // empty object, a trade without keys
+        }
+        unsigned keys = 0;
+        while (true)
+        {
+            // "key": value or "key": "value"
+            if (text[*position] != '"')
+            {
+                return MY_PARSE_ERROR;
+            }
+            if (end - position < 3)
+            {
+                return MY_PARSE_INCOMPLETE;
+            }
+            if (text[position[1]] != '"' || text[position[2]] != ':')
+            {
+                return MY_PARSE_ERROR;
+            }
+            std::string_view key(text + position[0] + 1, position[1] - position[0] - 1);
+            uint32_t colon = position[2];
+            position += 3;
+            if (position == end)
+            {
+                return MY_PARSE_INCOMPLETE; // a scalar value ends at the next structural character
+            }
+            std::string_view value;
+            if (text[*position] == '"')
+            {
+                if (end - position < 2)
+                {
+                    return MY_PARSE_INCOMPLETE;
+                }
+                value = std::string_view(text + position[0] + 1, position[1] - position[0] - 1);
+                position += 2;
+                if (position == end)
+                {
+                    return MY_PARSE_INCOMPLETE;
+                }
+            }
+            else
+            {
+                value = my_json_trim(std::string_view(text + colon + 1, *position - colon - 1));
+            }
+            if (!decode(key, value, &trade))
+            {
+                return MY_PARSE_ERROR;
+            }
+            keys |= my_aggtrade_key_bit(key);
+            char c = text[*position++];
+            if (c == '}')
+            {
+                return keys == MY_AGGTRADE_ALL_KEYS ? MY_PARSE_OK : MY_PARSE_ERROR;
+            }
+            if (c != ',')
+            {
+                return MY_PARSE_ERROR;
+            }
+            if (position == end)
+            {
+                return MY_PARSE_INCOMPLETE;
+            }
+        }
+    }
+
+public:
+    /// @brief Parser that decodes price and quantity as double only (PriceTicks and QuantityTicks stay 0).
+    MyAggTradeParser() = default;
+
+    /// @brief Parser that decodes price and quantity exactly into ticks, Price and Quantity are derived from the ticks.
+    /// @param scale Decimal places of the symbol. Values with more (non-zero) decimal places are rejected.
+    explicit MyAggTradeParser(MyDecimalScale scale) : scale(scale), exact(true) {}
+
+    /// @brief Decode exactly with another scale from now on, e.g. for the next symbol. The index is kept.
+    void set_scale(MyDecimalScale scale)
+    {
+        this->scale = scale;
+        this->exact = true;
+    }
+
+    /// @brief Parse the trades of a response.
+    /// @tparam Trades E.g. MyTradeBuffer or std::vector<AggTrade>, needs push_back(const AggTrade &).
+    /// @param json JSON array of aggTrade objects, only whitespace may follow the ']'.
+    /// @param trades The trades are appended.
+    /// @return False if the JSON is malformed, the trades before the error have been appended.
+    template <typename Trades>
+    bool parse(std::string_view json, Trades &trades)
+    {
+        MyArrayState state = MY_ARRAY_START;
+        size_t consumed;
+        return parse_partial(json, state, consumed, [&](const AggTrade &trade)
+                             { trades.push_back(trade); }) == MY_PARSE_OK &&
+               my_json_trim(json.substr(consumed)).empty();
+    }
+
+    /// @brief Parse all complete trades of a part of the array, e.g. of a response that is still downloading.
+    /// @details A trade is only passed to on_trade once its '}' is part of the JSON. The caller passes the bytes
+    /// behind consumed again, followed by more data (see MyAggTradeStreamParser).
+    /// @param json Starts where the previous call stopped (consumed), at the '[' for the first call.
+    /// @param state In: the state after the previous call, MY_ARRAY_START for the first call. Out: the new state.
+    /// @param consumed Out: number of bytes that have been parsed completely.
+    /// @param on_trade Called with const AggTrade & for every complete trade, in order.
+    /// @return MY_PARSE_OK once ']' is parsed, MY_PARSE_INCOMPLETE if more data is needed.
+    template <typename OnTrade>
+    MyParseStatus parse_partial(std::string_view json, MyArrayState &state, size_t &consumed, OnTrade on_trade)
+    {
+        consumed = 0;
+        if (json.size() >= UINT32_MAX)
+        {
+            return MY_PARSE_ERROR;
+        }
+        // A string that is not terminated yet is no error here, the walk below stops in front of it.
+        my_build_structural_index(json, this->index);
+        const char *text = json.data();
+        const uint32_t *position = this->index.data();
+        const uint32_t *end = position + this->index.size();
+        AggTrade trade;
+        while (state != MY_ARRAY_END)
+        {
+            if (position == end)
+            {
+                return MY_PARSE_INCOMPLETE;
+            }
+            char c = text[*position];
+            if (state == MY_ARRAY_START)
+            {
+                if (c != '[')
+                {
+                    return MY_PARSE_ERROR;
+                }
+                consumed = *position++ + 1;
+                state = MY_ARRAY_FIRST;
+                continue;
+            }
+            if (c == ']')
+            {
+                consumed = *position + 1;
+                state = MY_ARRAY_END;
+                break;
+            }
+            if (state == MY_ARRAY_NEXT)
+            {
+                if (c != ',')
+                {
+                    return MY_PARSE_ERROR;
+                }
+                if (++position == end)
+                {
+                    return MY_PARSE_INCOMPLETE;
+                }
+                c = text[*position];
+            }
+            if (c != '{')
+            {
+                return MY_PARSE_ERROR;
+            }
+            MyParseStatus status = parse_object(text, position, end, trade);
+            if (status != MY_PARSE_OK)
+            {
+                return status;
+            }
+            consumed = position[-1] + 1;
+            state = MY_ARRAY_NEXT;
+            on_trade(trade);
+        }
+        return MY_PARSE_OK;
+    }
+
+    /// @brief Get the number of structural characters found by the last parse()/parse_partial(), e.g. for statistics.
+    size_t get_structural_count() { return this->index.size(); }
+};
+
+#endif
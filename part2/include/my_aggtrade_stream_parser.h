@@ -0,0 +1,95 @@
+#include <string>
+#include <string_view>
+#include "my_aggtrade_parser.h"
+
+#ifndef __MY_AGGTRADE_STREAM_PARSER_H__
+#define __MY_AGGTRADE_STREAM_PARSER_H__
+
+/// @brief Maximum number of bytes kept between chunks. An aggTrade object has about 150 bytes, thus more means
+/// the response is not an array of trades and the parse fails instead of buffering the whole response.
+const size_t MY_STREAM_MAX_PENDING_SIZE = 1 << 16;
+
+/// @brief Incremental parser of the JSON array of GET /fapi/v1/aggTrades for a response that arrives in chunks.
+/// @details The chunks may be split anywhere, e.g. in the middle of a number, a key or an escape sequence. Every
+/// trade is passed on as soon as its '}' has arrived. Only the bytes of the incomplete trade at the end of a chunk
+/// are kept, thus the memory does not grow with the size of the response. The complete trades of a chunk are
+/// parsed directly from the chunk (see MyAggTradeParser::parse_partial()).
+class MyAggTradeStreamParser
+{
+private:
+    MyAggTradeParser parser;
+    /// @brief The bytes behind the last complete trade, completed by the next chunk.
+    std::string pending;
+    MyArrayState state = MY_ARRAY_START;
+    bool failed = false;
+
+public:
+    /// @brief Parser that decodes price and quantity as double only.
+    MyAggTradeStreamParser() = default;
+
+    /// @brief Parser that decodes price and quantity exactly into ticks, see MyAggTradeParser.
+    explicit MyAggTradeStreamParser(MyDecimalScale scale) : parser(scale) {}
+
+    /// @brief Parse the next chunk of the response.
+    /// @param chunk Any number of bytes, only used during the call.
+    /// @param on_trade Called with const AggTrade & for every trade completed by this chunk, in order.
+    /// @return False if the response is malformed (also for all later chunks), e.g. to abort the download.
+    template <typename OnTrade>
+    bool feed(std::string_view chunk, OnTrade on_trade)
+    {
+        if (this->failed)
+        {
+            return false;
+        }
+        if (this->state == MY_ARRAY_END)
+        {
+            // Only whitespace may follow the ']'.
+            this->failed = !my_json_trim(chunk).empty();
+            return !this->failed;
+        }
+        std::string_view json = chunk;
+        if (!this->pending.empty())
+        {
+            this->pending.append(chunk);
+            json = this->pending;
+        }
+        size_t consumed;
+        if (this->parser.parse_partial(json, this->state, consumed, on_trade) == MY_PARSE_ERROR ||
+            json.size() - consumed > MY_STREAM_MAX_PENDING_SIZE ||
+            (this->state == MY_ARRAY_END && !my_json_trim(json.substr(consumed)).empty()))
+        {
+            this->failed = true;
+            this->pending.clear();
+            return false;
+        }
+        if (this->pending.empty())
+        {
+            this->pending.assign(chunk.substr(consumed));
+        }
+        else
+        {
+            this->pending.erase(0, consumed);
+        }
+        return true;
+    }
+
+    /// @brief Prepare the parser for the next response, the memory is kept.
+    void reset()
+    {
+        this->pending.clear();
+        this->state = MY_ARRAY_START;
+        this->failed = false;
+    }
+
+    /// @brief True once the ']' of the array has arrived, i.e. all trades have been passed on, and nothing but
+    /// whitespace has followed it.
+    bool is_complete() { return this->state == MY_ARRAY_END && !this->failed; }
+
+    /// @brief True if the response is malformed.
+    bool has_failed() { return this->failed; }
+
+    /// @brief Get the number of bytes kept for the next chunk.
+    size_t get_pending_size() { return this->pending.size(); }
+};
+
+#endif
@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "my_aggtrade_stream_parser.h"
+#include "my_trade_buffer.h"
+
+#ifndef __MY_BACKFILL_H__
+#define __MY_BACKFILL_H__
+
+// -----------------------------------------------------------
+// Backfill: download a range of historical aggTrades with several requests at once. The range is split into
+// pages of fromId = from_id + i * page_size, which are independent of each other. Every worker fetches one page
+// at a time over its own (keep-alive) connection and parses it while it downloads. The pages are merged in the
+// order of their ids.
+// -----------------------------------------------------------
+
+/// @brief Request weight of GET /fapi/v1/aggTrades.
+const int MY_AGGTRADES_WEIGHT = 20;
+/// @brief Request weight limit per minute of the API (REQUEST_WEIGHT of GET /fapi/v1/exchangeInfo).
+const int MY_WEIGHT_LIMIT_PER_MINUTE = 2400;
+/// @brief Maximum number of trades per request of GET /fapi/v1/aggTrades.
+const unsigned MY_BACKFILL_MAX_PAGE_SIZE = 1000;
+/// @brief Attempts per page before the backfill fails.
+const unsigned MY_BACKFILL_MAX_ATTEMPTS = 5;
+/// @brief Delay before the second attempt of a failed request (e.g. 5xx, no connection), doubled for every further
+/// attempt, see my_retry_backoff().
+const std::chrono::milliseconds MY_BACKFILL_RETRY_DELAY(1000);
+/// @brief Maximum delay between two attempts of a request.
+const std::chrono::milliseconds MY_BACKFILL_MAX_RETRY_DELAY(30000);
+/// @brief Pages fetched ahead of the next page to merge, per worker. Bounds the memory if one page is slow.
+const unsigned MY_BACKFILL_WINDOW_PER_WORKER = 2;
+
+/// @brief Result of one HTTP request of a fetcher, see MyBackfill.
+struct MyFetchResult
+{
+    /// @brief HTTP status code, 0 if the request failed (e.g. no connection).
+    long status_code = 0;
+    /// @brief Value of the header X-MBX-USED-WEIGHT-1M, -1 if missing.
+    int used_weight = -1;
+    /// @brief Value of the header Retry-After in seconds, -1 if missing.
+    int retry_after = -1;
+    std::string error_message;
+};
+
+/// @brief Request weight budget per minute shared by all workers.
+/// @details Like the API, the budget is counted per minute of the wall clock. The weight reported by the server
+/// (X-MBX-USED-WEIGHT-1M) replaces the own count if it is higher, e.g. because another process uses the same IP.
+/// A 429/418 response pauses all workers for the time of its Retry-After header.
+class MyRateLimiter
+{
+private:
+    std::mutex mutex;
+    int limit;
+    int used = 0;
+    int64_t minute = 0;
+    std::chrono::system_clock::time_point paused_until;
+
+    static int64_t current_minute(std::chrono::system_clock::time_point now)
+    {
+        return std::chrono::duration_cast<std::chrono::minutes>(now.time_since_epoch()).count();
+    }
+
+public:
+    explicit MyRateLimiter(int limit = MY_WEIGHT_LIMIT_PER_MINUTE) : limit(limit) {}
+
+    /// @brief Wait until the weight fits into the budget of the current minute and take it.
+    void acquire(int weight)
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (true)
+        {
+            std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+            std::chrono::system_clock::time_point wait_until = this->paused_until;
+            if (now >= this->paused_until)
+            {
+                if (current_minute(now) != this->minute)
+                {
+                    this->minute = current_minute(now);
+                    this->used = 0;
+                }
+                if (this->used + weight <= this->limit)
+                {
+                    this->used += weight;
+                    return;
+                }
+                wait_until = std::chrono::system_clock::time_point(std::chrono::minutes(this->minute + 1));
+            }
+            lock.unlock();
+            std::this_thread::sleep_until(wait_until);
+            lock.lock();
+        }
+    }
+
+    /// @brief Take the weight reported by the server into account.
+    void report_used_weight(int used_weight)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (current_minute(std::chrono::system_clock::now()) == this->minute)
+        {
+            this->used = std::max(this->used, used_weight);
+        }
+    }
+
+    /// @brief Stop all requests for the given time, e.g. after 429 Too Many Requests.
+    void pause(std::chrono::seconds duration)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->paused_until = std::max(this->paused_until, std::chrono::system_clock::now() + duration);
+    }
+};
+
+/// @brief Request counters shared by the threads of a backfill, see my_fetch_with_retry().
+struct MyRequestCounters
+{
+    std::atomic<size_t> requests{0};     // requests sent, including retries
+    std::atomic<size_t> retries{0};      // failed requests that have been repeated
+    std::atomic<size_t> rate_limited{0}; // responses 429/418
+};
+
+/// @brief Wait before the next attempt of a failed request: exponential backoff with jitter.
+/// @details The delay starts at MY_BACKFILL_RETRY_DELAY and doubles with every attempt up to
+/// MY_BACKFILL_MAX_RETRY_DELAY. A random part of up to half of it is dropped, so that the workers that failed at the
+/// same time (e.g. during a short outage) do not retry in lockstep.
+/// @param attempt The attempt that failed, 0 for the first.
+/// @param stop Optional, the wait ends early once it is set.
+inline void my_retry_backoff(unsigned attempt, const std::atomic<bool> *stop = nullptr)
+{
+    thread_local std::minstd_rand random((unsigned)std::hash<std::thread::id>()(std::this_thread::get_id()));
+    int64_t delay = std::min<int64_t>(MY_BACKFILL_RETRY_DELAY.count() << std::min(attempt, 16u), MY_BACKFILL_MAX_RETRY_DELAY.count());
+    delay -= (int64_t)(random() % (uint64_t)(delay / 2 + 1));
+    std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay);
+    for (std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now(); now < until && (stop == nullptr || !*stop);
+         now = std::chrono::steady_clock::now())
+    {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(until - now, std::chrono::milliseconds(50)));
+    }
+}
+
+/// @brief Send a request until its response is complete, at most MY_BACKFILL_MAX_ATTEMPTS times. The retry loop of
+/// MyBackfill, MyPipeline and MyMultiSymbolIngest.
+/// @details Every attempt takes MY_AGGTRADES_WEIGHT from the limiter and reports the weight used by the server. A
+/// 429/418 response pauses all requests of the limiter for its Retry-After, any other failed attempt waits with
+/// my_retry_backoff() before the next one.
+/// @tparam Fetcher See MyBackfill.
+/// @param fetcher
+/// @param limiter
+/// @param url
+/// @param counters
+/// @param begin Called before every attempt, e.g. to clear the buffers of the previous attempt.
+/// @param on_chunk Called with std::string_view for every chunk of the body, returns false to abort.
+/// @param is_complete Called after a response 200, returns false if the body is incomplete or malformed.
+/// @param stop Optional, no further attempt once it is set.
+/// @return False if all attempts failed.
+template <typename Fetcher, typename Begin, typename OnChunk, typename IsComplete>
+bool my_fetch_with_retry(Fetcher &fetcher, MyRateLimiter &limiter, const std::string &url, MyRequestCounters &counters,
+                         Begin begin, OnChunk on_chunk, IsComplete is_complete, const std::atomic<bool> *stop = nullptr)
+{
+    for (unsigned attempt = 0; attempt < MY_BACKFILL_MAX_ATTEMPTS && (stop == nullptr || !*stop); attempt++)
+    {
+        if (attempt > 0)
+        {
+            counters.retries++;
+        }
+        begin();
+        limiter.acquire(MY_AGGTRADES_WEIGHT);
+        counters.requests++;
+        MyFetchResult result = fetcher.get(url, on_chunk);
+        if (result.used_weight >= 0)
+        {
+            limiter.report_used_weight(result.used_weight);
+        }
+        if (result.status_code == 429 || result.status_code == 418)
+        {
+            counters.rate_limited++;
+            limiter.pause(std::chrono::seconds(result.retry_after > 0 ? result.retry_after : 1));
+        }
+        else if (result.status_code == 200 && is_complete())
+        {
+            return true;
+        }
+        else if (attempt + 1 < MY_BACKFILL_MAX_ATTEMPTS)
+        {
+            my_retry_backoff(attempt, stop);
+        }
+    }
+    return false;
+}
+
+/// @brief Statistics of a backfill.
+struct MyBackfillStats
+{
+    uint64_t trades = 0;     // trades passed on
+    uint64_t duplicates = 0; // trades dropped because their id has been passed on already (overlapping pages)
+    uint64_t missing = 0;    // ids skipped between two trades (gaps)
+    size_t pages = 0;        // pages merged
+    size_t requests = 0;     // requests sent, including retries
+    size_t retries = 0;      // failed requests that have been repeated
+    size_t rate_limited = 0; // responses 429/418
+    bool failed = false;     // a page failed MY_BACKFILL_MAX_ATTEMPTS times, the trades before it are complete
+};
+
+/// @brief Backfill engine for GET /fapi/v1/aggTrades, see above.
+/// @tparam Fetcher Sends one GET request, one instance per worker (e.g. MyCprFetcher, one keep-alive connection each):
+/// MyFetchResult get(const std::string &url, OnChunk on_chunk), where on_chunk(std::string_view) returns false to abort.
+template <typename Fetcher>
+class MyBackfill
+{
+private:
+    std::string url_prefix;
+    MyDecimalScale scale;
+    unsigned worker_count;
+    unsigned page_size;
+    MyRateLimiter limiter;
+
+    /// @brief Fetch and parse one page while it downloads, see my_fetch_with_retry().
+    /// @return False if the page failed.
+    bool fetch_page(Fetcher &fetcher, MyAggTradeStreamParser &parser, const std::string &url, MyTradeBuffer &trades,
+                    MyRequestCounters &counters)
+    {
+        return my_fetch_with_retry(
+            fetcher, this->limiter, url, counters, [&]()
+            { trades.clear(); parser.reset(); },
+            [&](std::string_view chunk)
+            { return parser.feed(chunk, [&](const AggTrade &trade)
+                                 { trades.push_back(trade); }); },
+            [&]()
+            { return parser.is_complete(); });
+    }
+
+public:
+    /// @brief Constructor
+    /// @param base_url E.g. "https://fapi.binance.com" or the address of a local mock server.
+    /// @param symbol E.g. "BTCUSDT".
+    /// @param scale Decimal places of price and quantity of the symbol.
+    /// @param worker_count Number of requests at once, each worker has its own connection.
+    /// @param page_size Trades per request, at most MY_BACKFILL_MAX_PAGE_SIZE.
+    /// @param weight_limit Request weight per minute of all workers together.
+    MyBackfill(const std::string &base_url, const std::string &symbol, MyDecimalScale scale, unsigned worker_count = 4,
+               unsigned page_size = MY_BACKFILL_MAX_PAGE_SIZE, int weight_limit = MY_WEIGHT_LIMIT_PER_MINUTE)
+        : url_prefix(base_url + "/fapi/v1/aggTrades?symbol=" + symbol), scale(scale), worker_count(std::max(1u, worker_count)),
+          page_size(std::min(std::max(1u, page_size), MY_BACKFILL_MAX_PAGE_SIZE)), limiter(weight_limit) {}
+
+    /// @brief Get the id of the first trade at or after a time, e.g. to backfill a time range.
+    /// @param time Milliseconds since the epoch.
+    /// @param id
+    /// @return False if the request failed or there is no trade at or after the time.
+    bool find_id(int64_t time, unsigned long long &id)
+    {
+        Fetcher fetcher;
+        MyAggTradeStreamParser parser(this->scale);
+        MyTradeBuffer trades(1);
+        MyRequestCounters counters;
+        std::string url = this->url_prefix + "&startTime=" + std::to_string(time) + "&limit=1";
+        if (!fetch_page(fetcher, parser, url, trades, counters) || trades.empty())
+        {
+            return false;
+        }
+        id = trades.get_ids()[0];
+        return true;
+    }
+
+    /// @brief Download all trades with an id in [from_id, to_id] and pass them on in the order of their ids.
+    /// @details Trades are passed on while the later pages are still downloading. The backfill ends at to_id or
+    /// at the first empty page (no newer trades).
+    /// @param from_id
+    /// @param to_id E.g. UINT64_MAX for all trades up to now.
+    /// @param on_trade Called with const AggTrade & on the calling thread, every id at most once.
+    /// @return
+    template <typename OnTrade>
+    MyBackfillStats run(unsigned long long from_id, unsigned long long to_id, OnTrade on_trade)
+    {
+        MyBackfillStats stats;
+        if (from_id > to_id)
+        {
+            return stats;
+        }
+        size_t page_count = (size_t)std::min<unsigned long long>((to_id - from_id) / this->page_size + 1, SIZE_MAX);
+        size_t window = (size_t)this->worker_count * MY_BACKFILL_WINDOW_PER_WORKER;
+
+        std::mutex mutex;
+        std::condition_variable page_done;  // a worker finished a page
+        std::condition_variable page_taken; // the merger took a page, the window moved
+        size_t next_page = 0;               // next page to fetch
+        size_t next_merge = 0;              // next page to merge
+        bool stop = false;
+        std::map<size_t, std::unique_ptr<MyTradeBuffer>> done_pages; // nullptr: the page failed
+        std::vector<std::unique_ptr<MyTradeBuffer>> free_buffers;    // reused, no allocation per page
+        MyRequestCounters counters;
+
+        auto work = [&]()
+        {
+            Fetcher fetcher;
+            MyAggTradeStreamParser parser(this->scale);
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                page_taken.wait(lock, [&]()
+                                { return stop || next_page >= page_count || next_page < next_merge + window; });
+                if (stop || next_page >= page_count)
+                {
+                    return;
+                }
+                size_t page = next_page++;
+                std::unique_ptr<MyTradeBuffer> trades;
+                if (free_buffers.empty())
+                {
+                    trades = std::make_unique<MyTradeBuffer>(this->page_size);
+                }
+                else
+                {
+                    trades = std::move(free_buffers.back());
+                    free_buffers.pop_back();
+                }
+                lock.unlock();
+                std::string url = this->url_prefix + "&fromId=" + std::to_string(from_id + (unsigned long long)page * this->page_size) +
+                                  "&limit=" + std::to_string(this->page_size);
+                bool ok = fetch_page(fetcher, parser, url, *trades, counters);
+                lock.lock();
+                if (!ok)
+                {
+                    free_buffers.push_back(std::move(trades)); // trades is nullptr now, marks the page as failed
+                }
+                done_pages[page] = std::move(trades);
+                page_done.notify_all();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned w = 0; w < this->worker_count; w++)
+        {
+            workers.emplace_back(work);
+        }
+
+        // Merge on this thread: take the pages in order, drop ids that have been passed on, count skipped ids.
+        unsigned long long next_id = from_id;
+        bool end = false;
+        while (!end && next_merge < page_count)
+        {
+            std::unique_ptr<MyTradeBuffer> trades;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                page_done.wait(lock, [&]()
+                               { return done_pages.count(next_merge) != 0; });
+                trades = std::move(done_pages[next_merge]);
+                done_pages.erase(next_merge);
+                next_merge++;
+                page_taken.notify_all();
+            }
+            if (trades == nullptr)
+            {
+                stats.failed = true;
+                break;
+            }
+            stats.pages++;
+            end = trades->empty();
+            const unsigned long long *ids = trades->get_ids();
+            for (size_t i = 0; i < trades->size(); i++)
+            {
+                if (ids[i] > to_id)
+                {
+                    end = true;
+                    break;
+                }
+                if (ids[i] < next_id)
+                {
+                    stats.duplicates++;
+                    continue;
+                }
+                stats.missing += ids[i] - next_id;
+                next_id = ids[i] + 1;
+                stats.trades++;
+                on_trade(trades->get(i));
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            free_buffers.push_back(std::move(trades));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+            page_taken.notify_all();
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        stats.requests = counters.requests;
+        stats.retries = counters.retries;
+        stats.rate_limited = counters.rate_limited;
+        return stats;
+    }
+};
+
+#endif
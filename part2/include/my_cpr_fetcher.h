@@ -0,0 +1,44 @@
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <cpr/cpr.h>
+#include "my_backfill.h"
+
+#ifndef __MY_CPR_FETCHER_H__
+#define __MY_CPR_FETCHER_H__
+
+/// @brief Fetcher of MyBackfill with cpr. The session keeps its connection open (keep-alive), thus only the
+/// first request of a worker pays for the TCP and TLS handshake.
+class MyCprFetcher
+{
+private:
+    cpr::Session session;
+
+    static int get_header(const cpr::Response &response, const char *name)
+    {
+        auto header = response.header.find(name); // case insensitive
+        return header == response.header.end() ? -1 : atoi(header->second.c_str());
+    }
+
+public:
+    /// @brief Send GET url and pass the body on chunk by chunk while it downloads.
+    /// @param url
+    /// @param on_chunk Called with std::string_view, returns false to abort the download.
+    /// @return
+    template <typename OnChunk>
+    MyFetchResult get(const std::string &url, OnChunk on_chunk)
+    {
+        this->session.SetUrl(cpr::Url{url});
+        this->session.SetWriteCallback(cpr::WriteCallback{[&](std::string_view chunk, intptr_t) -> bool
+                                                          { return on_chunk(chunk); }});
+        cpr::Response response = this->session.Get();
+        MyFetchResult result;
+        result.status_code = response.status_code;
+        result.used_weight = get_header(response, "X-MBX-USED-WEIGHT-1M");
+        result.retry_after = get_header(response, "Retry-After");
+        result.error_message = response.error.message;
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#ifndef __MY_DECIMAL_H__
+#define __MY_DECIMAL_H__
+
+// -----------------------------------------------------------
+// Exact decimals: a price or quantity is stored as an integer number of ticks of 10^-scale, e.g. "62037.70"
+// with scale 2 is 6203770. Parsing and printing do not depend on the locale and do not round.
+// -----------------------------------------------------------
+
+/// @brief Maximum number of decimal places, 10^18 still fits into int64_t.
+const unsigned int MY_DECIMAL_MAX_SCALE = 18;
+/// @brief Size of a buffer that holds any decimal printed by my_format_decimal(): sign, 19 digits, '.', leading '0'.
+const size_t MY_DECIMAL_BUFFER_SIZE = 24;
+
+/// @brief Powers of 10 up to 10^MY_DECIMAL_MAX_SCALE.
+const int64_t MY_POW10[MY_DECIMAL_MAX_SCALE + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000, 100000000000,
+    1000000000000, 10000000000000, 100000000000000, 1000000000000000, 10000000000000000, 100000000000000000,
+    1000000000000000000};
+
+/// @brief Number of decimal places of the prices and quantities of a symbol.
+/// @details See pricePrecision and quantityPrecision of GET /fapi/v1/exchangeInfo, e.g. 2 and 3 for BTCUSDT.
+struct MyDecimalScale
+{
+    unsigned int price;
+    unsigned int quantity;
+};
+
+/// @brief Check whether 8 bytes are all ASCII digits.
+inline bool my_is_eight_digits(uint64_t chunk)
+{
+    // A byte is a digit if its high nibble is 3 and adding 6 to it does not carry into the high nibble.
+    return ((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+/// @brief Convert 8 ASCII digits (little-endian load) with 3 multiplications instead of 8 (SWAR, like simdjson).
+inline uint32_t my_parse_eight_digits(uint64_t chunk)
+{
+    chunk -= 0x3030303030303030ull;
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FFull) * 0x000F424000000064ull) + (((chunk >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+    return (uint32_t)chunk;
+}
+
+/// @brief Parse an unsigned integer, the whole text must be a number.
+/// @details The ids and timestamps of the API have 10 to 13 digits: the first 8 are converted at once, then digit by digit.
+/// At most 19 digits are accepted, thus the result never overflows.
+inline bool my_parse_uint64(std::string_view text, unsigned long long *value)
+{
+    if (text.empty() || text.size() > 19)
+    {
+        return false;
+    }
+    const char *data = text.data();
+    size_t i = 0;
+    unsigned long long result = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || defined(_MSC_VER)
+    for (; i + 8 <= text.size(); i += 8)
+    {
+        uint64_t chunk;
+        memcpy(&chunk, data + i, sizeof(chunk));
+        if (!my_is_eight_digits(chunk))
+        {
+            return false;
+        }
+        result = 100000000 * result + my_parse_eight_digits(chunk);
+    }
+#endif
+    for (; i < text.size(); i++)
+    {
+        unsigned int digit = (unsigned int)(data[i] - '0');
+        if (digit > 9)
+        {
+            return false;
+        }
+        result = 10 * result + digit;
+    }
+    *value = result;
+    return true;
+}
+
+/// @brief Parse a decimal number into ticks of 10^-scale, e.g. "0.002" with scale 3 is 2.
+/// @details The integer part and the decimal places are converted with my_parse_uint64(), i.e. 8 digits at once.
+/// Decimal places beyond the scale are accepted if they are 0 ("0.0020" with scale 3), otherwise the value is
+/// not representable and rejected.
+/// @param text [-]digits[.digits]
+/// @param scale At most MY_DECIMAL_MAX_SCALE.
+/// @param ticks
+/// @return False if the text is not a decimal number, needs more decimal places than the scale or overflows.
+inline bool my_parse_decimal(std::string_view text, unsigned int scale, int64_t *ticks)
+{
+    bool negative = !text.empty() && text[0] == '-';
+    if (negative)
+    {
+        text.remove_prefix(1);
+    }
+    size_t dot = text.find('.');
+    std::string_view integer_part = text.substr(0, dot);
+    std::string_view fraction = dot == std::string_view::npos ? std::string_view() : text.substr(dot + 1);
+    if (scale > MY_DECIMAL_MAX_SCALE || (dot != std::string_view::npos && fraction.empty()))
+    {
+        return false;
+    }
+    unsigned long long integer = 0;
+    unsigned long long decimals = 0;
+    if (!my_parse_uint64(integer_part, &integer) || integer > (unsigned long long)(INT64_MAX / MY_POW10[scale]))
+    {
+        return false;
+    }
+    size_t used = std::min<size_t>(fraction.size(), scale);
+    if (used > 0 && !my_parse_uint64(fraction.substr(0, used), &decimals))
+    {
+        return false;
+    }
+    for (char c : fraction.substr(used))
+    {
+        if (c != '0')
+        {
+            return false;
+        }
+    }
+    // Cannot overflow as unsigned: integer * 10^scale <= INT64_MAX and the decimals are < 10^scale.
+    unsigned long long result = integer * (unsigned long long)MY_POW10[scale] + decimals * (unsigned long long)MY_POW10[scale - used];
+    if (result > (unsigned long long)INT64_MAX)
+    {
+        return false;
+    }
+    *ticks = negative ? -(int64_t)result : (int64_t)result;
+    return true;
+}
+
+/// @brief Print ticks of 10^-scale with exactly scale decimal places, the inverse of my_parse_decimal().
+/// @param ticks
+/// @param scale At most MY_DECIMAL_MAX_SCALE.
+/// @param buffer At least MY_DECIMAL_BUFFER_SIZE characters, not null-terminated.
+/// @return Number of characters written.
+inline size_t my_format_decimal(int64_t ticks, unsigned int scale, char *buffer)
+{
+    char *out = buffer;
+    // Work with the absolute value as unsigned, so that INT64_MIN is no special case.
+    unsigned long long value = (unsigned long long)ticks;
+    if (ticks < 0)
+    {
+        *out++ = '-';
+        value = 0 - value;
+    }
+    unsigned long long power = (unsigned long long)MY_POW10[scale];
+    out = std::to_chars(out, buffer + MY_DECIMAL_BUFFER_SIZE, value / power).ptr;
+    if (scale > 0)
+    {
+        *out++ = '.';
+        unsigned long long decimals = value % power;
+        for (unsigned int i = scale; i > 0; i--)
+        {
+            out[i - 1] = (char)('0' + decimals % 10);
+            decimals /= 10;
+        }
+        out += scale;
+    }
+    return (size_t)(out - buffer);
+}
+
+/// @brief Convert ticks to a double, equal to parsing the decimal string with std::stod/std::from_chars (correctly
+/// rounded) as long as |ticks| < 2^53.
+inline double my_decimal_to_double(int64_t ticks, unsigned int scale)
+{
+    return (double)ticks / (double)MY_POW10[scale];
+}
+
+#endif
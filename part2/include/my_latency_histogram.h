@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifndef __MY_LATENCY_HISTOGRAM_H__
+#define __MY_LATENCY_HISTOGRAM_H__
+
+/// @brief Bits of a value that are kept exactly by MyLatencyHistogram: 2^7 = 128 values per power of 2, i.e. an
+/// error below 1%.
+const unsigned MY_HISTOGRAM_PRECISION_BITS = 7;
+const size_t MY_HISTOGRAM_SUB_BUCKETS = (size_t)1 << MY_HISTOGRAM_PRECISION_BITS;
+const size_t MY_HISTOGRAM_HALF_SUB_BUCKETS = MY_HISTOGRAM_SUB_BUCKETS / 2;
+/// @brief Buckets for all 64 bit values: the first 128 values exactly, then 64 buckets per power of 2.
+const size_t MY_HISTOGRAM_BUCKETS = MY_HISTOGRAM_SUB_BUCKETS + (64 - MY_HISTOGRAM_PRECISION_BITS) * MY_HISTOGRAM_HALF_SUB_BUCKETS;
+
+/// @brief Index of the highest set bit, value must not be 0.
+inline unsigned my_highest_bit(uint64_t value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanReverse(&index, (unsigned long)(value >> 32)))
+    {
+        return 32 + index;
+    }
+    _BitScanReverse(&index, (unsigned long)value);
+    return index;
+#else
+    return 63 - (unsigned)__builtin_clzll(value);
+#endif
+}
+
+/// @brief Histogram of latencies (e.g. in nanoseconds) with a fixed relative error, like HdrHistogram.
+/// @details Values below 128 have their own bucket. Above, every power of 2 is split into 64 buckets of the same
+/// width, so a bucket is less than 1% of its values wide whether it holds microseconds or seconds. record() is a
+/// few instructions and never allocates, thus every thread of a pipeline can record into its own histogram; they
+/// are merged afterwards with add().
+class MyLatencyHistogram
+{
+private:
+    std::vector<uint64_t> counts;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+
+    static size_t get_bucket(uint64_t value)
+    {
+        if (value < MY_HISTOGRAM_SUB_BUCKETS)
+        {
+            return (size_t)value;
+        }
+        unsigned shift = my_highest_bit(value) - (MY_HISTOGRAM_PRECISION_BITS - 1);
+        return MY_HISTOGRAM_SUB_BUCKETS + (shift - 1) * MY_HISTOGRAM_HALF_SUB_BUCKETS + (size_t)(value >> shift) - MY_HISTOGRAM_HALF_SUB_BUCKETS;
+    }
+
+    /// @brief Highest value of a bucket.
+    static uint64_t get_bucket_value(size_t bucket)
+    {
+        if (bucket < MY_HISTOGRAM_SUB_BUCKETS)
+        {
+            return bucket;
+        }
+        unsigned shift = (unsigned)((bucket - MY_HISTOGRAM_SUB_BUCKETS) / MY_HISTOGRAM_HALF_SUB_BUCKETS) + 1;
+        uint64_t sub_bucket = (bucket - MY_HISTOGRAM_SUB_BUCKETS) % MY_HISTOGRAM_HALF_SUB_BUCKETS + MY_HISTOGRAM_HALF_SUB_BUCKETS;
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+public:
+    MyLatencyHistogram() : counts(MY_HISTOGRAM_BUCKETS, 0) {}
+
+    void record(uint64_t value)
+    {
+        this->counts[get_bucket(value)]++;
+        this->count++;
+        this->sum += value;
+        this->min = std::min(this->min, value);
+        this->max = std::max(this->max, value);
+    }
+
+    /// @brief Add all values of another histogram.
+    void add(const MyLatencyHistogram &other)
+    {
+        for (size_t i = 0; i < MY_HISTOGRAM_BUCKETS; i++)
+        {
+            this->counts[i] += other.counts[i];
+        }
+        this->count += other.count;
+        this->sum += other.sum;
+        this->min = std::min(this->min, other.min);
+        this->max = std::max(this->max, other.max);
+    }
+
+    void clear()
+    {
+        std::fill(this->counts.begin(), this->counts.end(), 0);
+        this->count = this->sum = this->max = 0;
+        this->min = UINT64_MAX;
+    }
+
+    /// @brief Get the value below or equal to which the given percentage of all values are, e.g. 99.9.
+    /// @return The highest value of its bucket (at most 1% too high), the maximum for 100, 0 if empty.
+    uint64_t get_percentile(double percentile) const
+    {
+        if (this->count == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(percentile / 100 * (double)this->count + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < MY_HISTOGRAM_BUCKETS; i++)
+        {
+            seen += this->counts[i];
+            if (seen >= rank)
+            {
+                return std::min(get_bucket_value(i), this->max);
+            }
+        }
+        return this->max;
+    }
+
+    uint64_t get_count() const { return this->count; }
+    uint64_t get_min() const { return this->count == 0 ? 0 : this->min; }
+    uint64_t get_max() const { return this->max; }
+    double get_mean() const { return this->count == 0 ? 0 : (double)this->sum / (double)this->count; }
+
+    /// @brief Print count, mean and percentiles in microseconds, the values must be nanoseconds.
+    void print_us(std::ostream &out) const
+    {
+        out << "n=" << get_count() << " mean=" << get_mean() / 1000 << " p50=" << get_percentile(50) / 1000.0
+            << " p90=" << get_percentile(90) / 1000.0 << " p99=" << get_percentile(99) / 1000.0
+            << " p99.9=" << get_percentile(99.9) / 1000.0 << " max=" << get_max() / 1000.0 << " us";
+    }
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "my_aggtrade_parser.h"
+#include "my_backfill.h"
+#include "my_frozen_hash_table.h"
+#include "my_hash_table.h"
+#include "my_trade_buffer.h"
+
+#ifndef __MY_MULTI_SYMBOL_H__
+#define __MY_MULTI_SYMBOL_H__
+
+// -----------------------------------------------------------
+// Multi-symbol ingestion: one process polls the new aggTrades of many symbols. A pool of connections (one Fetcher
+// and one parser per thread) is shared by all symbols and one MyRateLimiter holds the request weight budget of
+// all of them, instead of one process with its own TLS session, buffers and budget per symbol.
+// -----------------------------------------------------------
+
+/// @brief Decimal places that fit the prices and quantities of every futures symbol, for symbols without a scale.
+const MyDecimalScale MY_MULTI_SYMBOL_DEFAULT_SCALE = {8, 8};
+/// @brief Pages per symbol and poll, a symbol that is far behind does not hold its connection for longer.
+const unsigned MY_MULTI_SYMBOL_MAX_PAGES_PER_POLL = 10;
+
+/// @brief Statistics of one symbol since it has been added.
+struct MySymbolStats
+{
+    uint64_t trades = 0;     // trades passed on
+    uint64_t duplicates = 0; // trades dropped because their id has been passed on already
+    uint64_t missing = 0;    // ids skipped between two trades (gaps)
+    size_t requests = 0;     // requests sent, including retries
+    size_t failed = 0;       // pages that failed MY_BACKFILL_MAX_ATTEMPTS times
+    double notional = 0;     // sum of price * quantity, for the VWAP
+    double volume = 0;
+    int64_t last_time = 0;   // time of the newest trade
+};
+
+/// @brief State of one symbol. Only one thread works on a symbol at a time.
+struct MySymbolState
+{
+    uint32_t index;              // interned id of the symbol, see MyMultiSymbolIngest::add_symbol()
+    std::string symbol;
+    std::string url_prefix;      // request of the symbol without fromId
+    MyDecimalScale scale;
+    unsigned long long next_id;  // first id of the next poll, 0: start with the newest trades
+    MySymbolStats stats;
+};
+
+/// @brief Statistics of one poll of all symbols.
+struct MyMultiSymbolStats
+{
+    uint64_t trades = 0;
+    size_t requests = 0;
+    size_t retries = 0;
+    size_t rate_limited = 0;
+    size_t failed = 0; // pages that failed MY_BACKFILL_MAX_ATTEMPTS times
+    double seconds = 0;
+};
+
+/// @brief Options of MyMultiSymbolIngest.
+struct MyMultiSymbolOptions
+{
+    /// @brief Connections (threads) shared by all symbols.
+    unsigned connections = 4;
+    /// @brief Trades per request, at most MY_BACKFILL_MAX_PAGE_SIZE.
+    unsigned page_size = MY_BACKFILL_MAX_PAGE_SIZE;
+    int weight_limit = MY_WEIGHT_LIMIT_PER_MINUTE;
+};
+
+/// @brief Polls GET /fapi/v1/aggTrades of many symbols over a shared pool of connections, see above.
+/// @details The symbol names are interned when they are added: every name gets an index into the states, the
+/// names are stored once in a MyHashTable of part 1. Once all symbols have been added, the table is frozen into a
+/// MyFrozenHashTable (perfect hashing, read-only) by freeze() or the first poll(), thus find() is one lookup without
+/// probing and without a lock and may be called from any thread, e.g. to route messages by their symbol. Until then
+/// (or if the build failed) find() looks the name up in the MyHashTable. The requests of a symbol carry its index,
+/// they never look up the name.
+/// @tparam Fetcher See MyBackfill, one instance per connection.
+template <typename Fetcher>
+class MyMultiSymbolIngest
+{
+private:
+    std::string base_url;
+    MyMultiSymbolOptions options;
+    MyRateLimiter limiter;
+    std::vector<std::unique_ptr<MySymbolState>> states;
+    MyHashTable<std::string, uint32_t, MyWyHash> names;
+    MyFrozenHashTable<std::string, uint32_t, MyWyHash> index;
+    bool index_built = false; // freeze() has been called since the last add_symbol()
+    bool frozen = false;      // find() uses index, else names
+
+    /// @brief Connection of a thread: the fetcher (kept alive between polls), the response and the parsed trades,
+    /// reused for every symbol.
+    struct Connection
+    {
+        Fetcher fetcher;
+        MyAggTradeParser parser;
+        std::string json;
+        MyTradeBuffer trades;
+        MyTradeBuffer fresh; // the new trades of a page that overlaps the trades passed on
+
+        explicit Connection(size_t page_size) : trades(page_size), fresh(page_size) {}
+    };
+    std::vector<std::unique_ptr<Connection>> connections;
+
+    /// @brief Fetch and parse one page of a symbol, see my_fetch_with_retry().
+    bool fetch_page(Connection &connection, MySymbolState &state, MyRequestCounters &counters)
+    {
+        std::string url = state.url_prefix;
+        if (state.next_id != 0)
+        {
+            url += "&fromId=" + std::to_string(state.next_id);
+        }
+        connection.parser.set_scale(state.scale);
+        bool ok = my_fetch_with_retry(
+            connection.fetcher, this->limiter, url, counters, [&]()
+            { connection.json.clear(); connection.trades.clear(); state.stats.requests++; },
+            [&](std::string_view chunk)
+            { connection.json.append(chunk); return true; },
+            [&]()
+            { return connection.parser.parse(connection.json, connection.trades); });
+        if (!ok)
+        {
+            state.stats.failed++;
+        }
+        return ok;
+    }
+
+    /// @brief Drop the trades that have been passed on already and update the state and statistics.
+    /// @return The new trades: the parsed trades or, if some have been dropped, connection.fresh.
+    const MyTradeBuffer &merge(MySymbolState &state, Connection &connection)
+    {
+        const MyTradeBuffer &trades = connection.trades;
+        const unsigned long long *ids = trades.get_ids();
+        bool overlaps = state.next_id != 0 && !trades.empty() && ids[0] < state.next_id;
+        connection.fresh.clear();
+        for (size_t i = 0; i < trades.size(); i++)
+        {
+            if (state.next_id != 0 && ids[i] < state.next_id)
+            {
+                state.stats.duplicates++;
+                continue;
+            }
+            state.stats.missing += state.next_id != 0 ? ids[i] - state.next_id : 0;
+            state.next_id = ids[i] + 1;
+            state.stats.trades++;
+            state.stats.notional += trades.get_prices()[i] * trades.get_quantities()[i];
+            state.stats.volume += trades.get_quantities()[i];
+            state.stats.last_time = (int64_t)trades.get_timestamps()[i];
+            if (overlaps)
+            {
+                connection.fresh.push_back(trades.get(i));
+            }
+        }
+        return overlaps ? connection.fresh : trades;
+    }
+
+public:
+    /// @brief Constructor
+    /// @param base_url E.g. "https://fapi.binance.com" or the address of a local mock server.
+    /// @param options
+    explicit MyMultiSymbolIngest(const std::string &base_url, MyMultiSymbolOptions options = MyMultiSymbolOptions())
+        : base_url(base_url), options(options), limiter(options.weight_limit), names(64, true)
+    {
+        this->options.connections = std::max(1u, this->options.connections);
+        this->options.page_size = std::min(std::max(1u, this->options.page_size), MY_BACKFILL_MAX_PAGE_SIZE);
+    }
+
+    /// @brief Add a symbol, must not be called during poll(). Unfreezes the index until the next freeze() or poll().
+    /// @param symbol E.g. "BTCUSDT".
+    /// @param scale Decimal places of price and quantity of the symbol.
+    /// @param from_id First id of the first poll, 0: the first poll gets the newest page of trades.
+    /// @return The index of the symbol, the existing index if it has been added before.
+    uint32_t add_symbol(std::string_view symbol, MyDecimalScale scale = MY_MULTI_SYMBOL_DEFAULT_SCALE, unsigned long long from_id = 0)
+    {
+        std::pair<uint32_t *, bool> interned = this->names.try_emplace(symbol, (uint32_t)this->states.size());
+        if (!interned.second)
+        {
+            return *interned.first;
+        }
+        std::unique_ptr<MySymbolState> state = std::make_unique<MySymbolState>();
+        state->index = (uint32_t)this->states.size();
+        state->symbol = std::string(symbol);
+        state->url_prefix = this->base_url + "/fapi/v1/aggTrades?symbol=" + state->symbol + "&limit=" + std::to_string(this->options.page_size);
+        state->scale = scale;
+        state->next_id = from_id;
+        this->states.push_back(std::move(state));
+        this->index_built = false;
+        this->frozen = false;
+        return this->states.back()->index;
+    }
+
+    /// @brief Freeze the names into the perfect hash table used by find(). Called by poll(), call it earlier if find()
+    /// is used before the first poll. Builds the table once after the last add_symbol(), not per symbol.
+    /// @return False if the build failed (e.g. two names with the same 64-bit hash), find() then keeps using the
+    /// MyHashTable of the names, which is slower but correct.
+    bool freeze()
+    {
+        if (!this->index_built)
+        {
+            this->index_built = true;
+            this->frozen = this->index.build(this->names);
+        }
+        return this->frozen;
+    }
+
+    /// @brief Get the state of a symbol by its name. Thread-safe while no symbol is added and no freeze() runs.
+    /// @return nullptr if the symbol has not been added.
+    MySymbolState *find(std::string_view symbol)
+    {
+        const uint32_t *index = this->frozen ? this->index.get(symbol) : this->names.get(symbol);
+        return index == nullptr ? nullptr : this->states[*index].get();
+    }
+
+    MySymbolState &get_state(uint32_t index) { return *this->states[index]; }
+    size_t get_symbol_count() { return this->states.size(); }
+
+    /// @brief Fetch the new trades of every symbol once.
+    /// @details The threads take the symbols one after another. A symbol is fetched page by page until a page is
+    /// not full (it has caught up) or MY_MULTI_SYMBOL_MAX_PAGES_PER_POLL pages have been fetched, the rest follows
+    /// in the next poll. A failed page is tried again in the next poll. All requests share the weight budget.
+    /// @param on_batch Called with (const MySymbolState &, const MyTradeBuffer &) on the thread of the connection:
+    /// the new trades of one page of a symbol, in order. Never called for the same symbol at once.
+    /// @return
+    template <typename OnBatch>
+    MyMultiSymbolStats poll(OnBatch on_batch)
+    {
+        MyMultiSymbolStats stats;
+        std::atomic<size_t> next_symbol(0);
+        MyRequestCounters counters;
+        std::atomic<size_t> failed(0);
+        std::atomic<uint64_t> trades(0);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        this->freeze();
+
+        unsigned thread_count = (unsigned)std::min<size_t>(this->options.connections, std::max<size_t>(1, this->states.size()));
+        while (this->connections.size() < thread_count)
+        {
+            this->connections.push_back(std::make_unique<Connection>(this->options.page_size));
+        }
+        auto work = [&](Connection &connection)
+        {
+            for (size_t i = next_symbol++; i < this->states.size(); i = next_symbol++)
+            {
+                MySymbolState &state = *this->states[i];
+                for (unsigned page = 0; page < MY_MULTI_SYMBOL_MAX_PAGES_PER_POLL; page++)
+                {
+                    bool catching_up = state.next_id != 0;
+                    if (!fetch_page(connection, state, counters))
+                    {
+                        failed++;
+                        break;
+                    }
+                    const MyTradeBuffer &fresh = merge(state, connection);
+                    if (!fresh.empty())
+                    {
+                        on_batch((const MySymbolState &)state, fresh);
+                        trades += fresh.size();
+                    }
+                    if (!catching_up || connection.trades.size() < this->options.page_size)
+                    {
+                        break; // the newest page or caught up
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < thread_count; t++)
+        {
+            threads.emplace_back(work, std::ref(*this->connections[t]));
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        stats.trades = trades;
+        stats.requests = counters.requests;
+        stats.retries = counters.retries;
+        stats.rate_limited = counters.rate_limited;
+        stats.failed = failed;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "my_aggtrade_parser.h"
+#include "my_backfill.h"
+#include "my_latency_histogram.h"
+#include "my_ring_queue.h"
+#include "my_trade_buffer.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifndef __MY_PIPELINE_H__
+#define __MY_PIPELINE_H__
+
+// -----------------------------------------------------------
+// Pipeline: the backfill of MyBackfill split into stages with their own threads, so that each stage can be
+// measured on its own:
+//   fetch (N threads) --MPSC--> parse (1 thread) --SPSC--> sink (1 thread, in the order of the pages)
+// While page N is parsed, page N+1 is fetched and page N-1 is passed to the sink (e.g. formatted). The stages pass
+// pointers to batches (response and parsed trades) through lock-free queues. A fixed number of batches circulates,
+// thus a slow stage makes the stages in front of it wait (backpressure) instead of growing the memory.
+// -----------------------------------------------------------
+
+/// @brief Bind a thread to one CPU, e.g. to keep its caches warm. Only on Linux and Windows, elsewhere nothing happens.
+/// @return False if the thread could not be bound.
+inline bool my_pin_thread(std::thread &thread, unsigned cpu)
+{
+#if defined(_WIN32)
+    return SetThreadAffinityMask((HANDLE)thread.native_handle(), (DWORD_PTR)1 << (cpu % (8 * sizeof(DWORD_PTR)))) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CPU_SETSIZE, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    (void)cpu;
+    return false;
+#endif
+}
+
+/// @brief Options of MyPipeline.
+struct MyPipelineOptions
+{
+    unsigned fetch_threads = 4;
+    /// @brief Trades per request, at most MY_BACKFILL_MAX_PAGE_SIZE.
+    unsigned page_size = MY_BACKFILL_MAX_PAGE_SIZE;
+    /// @brief Batches in circulation, 0: 4 per fetch thread. Bounds the pages in flight and the memory.
+    size_t batch_count = 0;
+    /// @brief Bind the threads to CPUs: sink 0, parse 1, fetch 2, 3, ... (modulo the number of CPUs).
+    bool pin_threads = false;
+    int weight_limit = MY_WEIGHT_LIMIT_PER_MINUTE;
+};
+
+/// @brief Statistics of a pipeline run. Latencies are in nanoseconds per page.
+struct MyPipelineStats
+{
+    MyBackfillStats backfill;
+    MyLatencyHistogram fetch;       // request sent -> response complete (including retries and rate limit)
+    MyLatencyHistogram parse_wait;  // response complete -> parse starts, i.e. time in the queue
+    MyLatencyHistogram parse;       // structural index and decoding
+    MyLatencyHistogram sink_wait;   // parsed -> sink starts (queue and waiting for earlier pages)
+    MyLatencyHistogram sink;        // sink callback
+    MyLatencyHistogram end_to_end;  // request sent -> sink done
+    /// @brief Busy time per stage in seconds, e.g. fetch_busy / (fetch threads * seconds) near 1 limits throughput.
+    double fetch_busy = 0;
+    double parse_busy = 0;
+    double sink_busy = 0;
+    double seconds = 0;
+};
+
+/// @brief Backfill of GET /fapi/v1/aggTrades as a pipeline of stages, see above.
+/// @tparam Fetcher See MyBackfill, one instance per fetch thread.
+template <typename Fetcher>
+class MyPipeline
+{
+private:
+    using chrono_clock = std::chrono::steady_clock;
+
+    struct Batch
+    {
+        size_t page = 0;
+        std::string json;
+        MyTradeBuffer trades;
+        bool ok = false;
+        chrono_clock::time_point fetch_start;
+        chrono_clock::time_point fetch_end;
+        chrono_clock::time_point parse_end;
+    };
+
+    std::string url_prefix;
+    MyDecimalScale scale;
+    MyPipelineOptions options;
+    MyRateLimiter limiter;
+
+    static uint64_t to_ns(chrono_clock::duration duration)
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+
+public:
+    /// @brief Constructor
+    /// @param base_url E.g. "https://fapi.binance.com" or the address of a local mock server.
+    /// @param symbol E.g. "BTCUSDT".
+    /// @param scale Decimal places of price and quantity of the symbol.
+    /// @param options
+    MyPipeline(const std::string &base_url, const std::string &symbol, MyDecimalScale scale, MyPipelineOptions options = MyPipelineOptions())
+        : url_prefix(base_url + "/fapi/v1/aggTrades?symbol=" + symbol), scale(scale), options(options), limiter(options.weight_limit)
+    {
+        this->options.fetch_threads = std::max(1u, this->options.fetch_threads);
+        this->options.page_size = std::min(std::max(1u, this->options.page_size), MY_BACKFILL_MAX_PAGE_SIZE);
+        if (this->options.batch_count == 0)
+        {
+            this->options.batch_count = 4 * (size_t)this->options.fetch_threads;
+        }
+        this->options.batch_count = std::max<size_t>(this->options.batch_count, this->options.fetch_threads);
+    }
+
+    /// @brief Download all trades with an id in [from_id, to_id] and pass them on in the order of their ids.
+    /// @details Like MyBackfill::run(): ids that have been passed on are dropped, gaps are counted and the run ends
+    /// at to_id, at the first empty page or at a page that failed MY_BACKFILL_MAX_ATTEMPTS times.
+    /// @param from_id
+    /// @param to_id
+    /// @param on_batch Called with const MyTradeBuffer & on the sink thread, the trades of one page in order.
+    /// @return
+    template <typename OnBatch>
+    MyPipelineStats run(unsigned long long from_id, unsigned long long to_id, OnBatch on_batch)
+    {
+        MyPipelineStats stats;
+        if (from_id > to_id)
+        {
+            return stats;
+        }
+        const size_t page_count = (size_t)std::min<unsigned long long>((to_id - from_id) / this->options.page_size + 1, SIZE_MAX);
+        const size_t batch_count = this->options.batch_count;
+        std::vector<std::unique_ptr<Batch>> batches;
+        MyMpmcQueue<Batch *> free_batches(batch_count); // sink -> fetch
+        MyMpmcQueue<Batch *> fetched(batch_count + this->options.fetch_threads); // fetch -> parse, + end markers
+        MySpscQueue<Batch *> parsed(batch_count + 1);   // parse -> sink, + end marker
+        for (size_t i = 0; i < batch_count; i++)
+        {
+            batches.push_back(std::make_unique<Batch>());
+            batches.back()->trades.reserve(this->options.page_size);
+            free_batches.push(batches.back().get());
+        }
+        std::atomic<size_t> next_page(0);
+        std::atomic<bool> stop(false);
+        MyRequestCounters counters;
+        std::vector<MyLatencyHistogram> fetch_histograms(this->options.fetch_threads);
+        std::vector<double> fetch_busy(this->options.fetch_threads, 0);
+        chrono_clock::time_point start = chrono_clock::now();
+        auto page_url = [&](size_t page)
+        {
+            return this->url_prefix + "&fromId=" + std::to_string(from_id + (unsigned long long)page * this->options.page_size) +
+                   "&limit=" + std::to_string(this->options.page_size);
+        };
+
+        // Fetch: take a free batch first, then the next page. Thus the page the sink waits for always has a batch.
+        auto fetch = [&](unsigned thread)
+        {
+            Fetcher fetcher;
+            Batch *batch;
+            while (true)
+            {
+                free_batches.pop(batch);
+                size_t page = next_page++;
+                if (stop || page >= page_count)
+                {
+                    free_batches.push(batch);
+                    break;
+                }
+                batch->page = page;
+                batch->ok = false;
+                batch->fetch_start = chrono_clock::now();
+                batch->ok = my_fetch_with_retry(
+                    fetcher, this->limiter, page_url(page), counters, [&]()
+                    { batch->json.clear(); },
+                    [&](std::string_view chunk)
+                    { batch->json.append(chunk); return true; },
+                    []()
+                    { return true; }, &stop);
+                batch->fetch_end = chrono_clock::now();
+                fetch_histograms[thread].record(to_ns(batch->fetch_end - batch->fetch_start));
+                fetch_busy[thread] += std::chrono::duration<double>(batch->fetch_end - batch->fetch_start).count();
+                fetched.push(batch);
+            }
+            fetched.push(nullptr); // this thread is done
+        };
+
+        // Parse: one thread, the structural index is reused for every page. A response 200 that fails to parse is
+        // fetched again here with the retry loop of MyBackfill, where the parse decides whether a response is complete.
+        // This stalls the parse stage, but only for malformed responses.
+        auto parse = [&]()
+        {
+            MyAggTradeParser parser(this->scale);
+            Fetcher fetcher;
+            Batch *batch;
+            for (unsigned done = 0; done < this->options.fetch_threads;)
+            {
+                fetched.pop(batch);
+                if (batch == nullptr)
+                {
+                    done++;
+                    continue;
+                }
+                chrono_clock::time_point parse_start = chrono_clock::now();
+                stats.parse_wait.record(to_ns(parse_start - batch->fetch_end));
+                batch->trades.clear();
+                if (batch->ok && !parser.parse(batch->json, batch->trades))
+                {
+                    counters.retries++;
+                    my_retry_backoff(0, &stop);
+                    batch->ok = my_fetch_with_retry(
+                        fetcher, this->limiter, page_url(batch->page), counters, [&]()
+                        { batch->json.clear(); batch->trades.clear(); },
+                        [&](std::string_view chunk)
+                        { batch->json.append(chunk); return true; },
+                        [&]()
+                        { return parser.parse(batch->json, batch->trades); }, &stop);
+                }
+                batch->parse_end = chrono_clock::now();
+                stats.parse.record(to_ns(batch->parse_end - parse_start));
+                stats.parse_busy += std::chrono::duration<double>(batch->parse_end - parse_start).count();
+                parsed.push(batch);
+            }
+            parsed.push(nullptr);
+        };
+
+        // Sink: restore the order of the pages (at most batch_count are in flight), filter and pass them on.
+        auto sink = [&]()
+        {
+            std::vector<Batch *> pending(batch_count, nullptr); // page % batch_count
+            size_t next_merge = 0;
+            unsigned long long next_id = from_id;
+            bool end = false;
+            MyTradeBuffer filtered(this->options.page_size);
+            Batch *batch;
+            while (true)
+            {
+                parsed.pop(batch);
+                if (batch == nullptr)
+                {
+                    break;
+                }
+                if (end)
+                {
+                    free_batches.push(batch); // pages behind the end, an earlier page may never arrive
+                    continue;
+                }
+                pending[batch->page % batch_count] = batch;
+                while (!end && (batch = pending[next_merge % batch_count]) != nullptr && batch->page == next_merge)
+                {
+                    pending[next_merge % batch_count] = nullptr;
+                    next_merge++;
+                    chrono_clock::time_point sink_start = chrono_clock::now();
+                    stats.sink_wait.record(to_ns(sink_start - batch->parse_end));
+                    if (!batch->ok)
+                    {
+                        stats.backfill.failed = true;
+                        end = true;
+                    }
+                    else
+                    {
+                        // Pass the page on as it is unless it overlaps the previous page or ends behind to_id.
+                        stats.backfill.pages++;
+                        const MyTradeBuffer &trades = batch->trades;
+                        const unsigned long long *ids = trades.get_ids();
+                        end = trades.empty() || ids[trades.size() - 1] >= to_id;
+                        bool filter = !trades.empty() && (ids[0] < next_id || ids[trades.size() - 1] > to_id);
+                        filtered.clear();
+                        for (size_t i = 0; i < trades.size(); i++)
+                        {
+                            if (ids[i] > to_id)
+                            {
+                                break;
+                            }
+                            if (ids[i] < next_id)
+                            {
+                                stats.backfill.duplicates++;
+                                continue;
+                            }
+                            stats.backfill.missing += ids[i] - next_id;
+                            next_id = ids[i] + 1;
+                            stats.backfill.trades++;
+                            if (filter)
+                            {
+                                filtered.push_back(trades.get(i));
+                            }
+                        }
+                        on_batch(filter ? (const MyTradeBuffer &)filtered : trades);
+                    }
+                    stop = stop || end;
+                    chrono_clock::time_point sink_end = chrono_clock::now();
+                    stats.sink.record(to_ns(sink_end - sink_start));
+                    stats.sink_busy += std::chrono::duration<double>(sink_end - sink_start).count();
+                    stats.end_to_end.record(to_ns(sink_end - batch->fetch_start));
+                    free_batches.push(batch);
+                }
+                for (Batch *&waiting : pending)
+                {
+                    if (end && waiting != nullptr)
+                    {
+                        free_batches.push(waiting);
+                        waiting = nullptr;
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.emplace_back(sink);
+        threads.emplace_back(parse);
+        for (unsigned t = 0; t < this->options.fetch_threads; t++)
+        {
+            threads.emplace_back(fetch, t);
+        }
+        unsigned cpu_count = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t t = 0; t < threads.size() && this->options.pin_threads; t++)
+        {
+            my_pin_thread(threads[t], (unsigned)t % cpu_count);
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        stats.seconds = std::chrono::duration<double>(chrono_clock::now() - start).count();
+        for (unsigned t = 0; t < this->options.fetch_threads; t++)
+        {
+            stats.fetch.add(fetch_histograms[t]);
+            stats.fetch_busy += fetch_busy[t];
+        }
+        stats.backfill.requests = counters.requests;
+        stats.backfill.retries = counters.retries;
+        stats.backfill.rate_limited = counters.rate_limited;
+        return stats;
+    }
+};
+
+#endif
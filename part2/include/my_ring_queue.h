@@ -0,0 +1,302 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef __MY_RING_QUEUE_H__
+#define __MY_RING_QUEUE_H__
+
+// -----------------------------------------------------------
+// Bounded lock-free queues between the threads of a pipeline. The capacity is a power of 2, the slots are
+// allocated once. A full queue makes push() wait (backpressure), an empty queue makes pop() wait: it spins and
+// yields for a short time, then the thread is parked until the other side has made progress, thus a stage that
+// waits for the network does not keep a core busy. The values are copied in and out, thus T should be small, e.g.
+// a pointer to a batch.
+// -----------------------------------------------------------
+
+/// @brief Alignment of the indexes of a queue, so that producer and consumer do not share a cache line.
+const size_t MY_QUEUE_ALIGNMENT = 64;
+/// @brief Failed attempts of push()/pop() before the thread yields.
+const int MY_QUEUE_SPIN_COUNT = 64;
+/// @brief Yields of a blocked push()/pop() before the thread is parked.
+const int MY_QUEUE_YIELD_COUNT = 16;
+
+/// @brief Wait strategy of a blocked push()/pop(): spin a little, then give the core to other threads.
+/// @return False once the thread should be parked, see MyQueueWaiter.
+inline bool my_queue_backoff(int &attempt)
+{
+    if (++attempt > MY_QUEUE_SPIN_COUNT + MY_QUEUE_YIELD_COUNT)
+    {
+        return false;
+    }
+    if (attempt > MY_QUEUE_SPIN_COUNT)
+    {
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+/// @brief Parks the threads that wait for one side of a queue (e.g. for a value to pop) until it is notified.
+/// @details notify() is one load of the number of parked threads unless a thread is parked, thus the queue stays
+/// lock-free while no thread waits. The fences make sure that either the parked thread sees the change of the
+/// queue when it tries again under the mutex, or notify() sees the parked thread: no wakeup is lost.
+class alignas(MY_QUEUE_ALIGNMENT) MyQueueWaiter
+{
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<int> waiting{0};
+
+public:
+    /// @brief Park the thread until ready() returns true.
+    /// @param ready E.g. a try_pop() of the queue, called under the mutex.
+    template <typename Ready>
+    void wait(Ready ready)
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->waiting.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        this->condition.wait(lock, ready);
+        this->waiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// @brief Wake the parked threads after the queue has changed.
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (this->waiting.load(std::memory_order_relaxed) != 0)
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->condition.notify_all();
+        }
+    }
+};
+
+inline size_t my_round_up_pow2(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+/// @brief Queue with one producer thread and one consumer thread.
+/// @details Each side owns one index and only reads the other: one atomic store per push and pop, no
+/// read-modify-write. Each side caches the last seen index of the other, so that it only reads the other's cache
+/// line when the queue looks full or empty.
+template <typename T>
+class MySpscQueue
+{
+private:
+    std::unique_ptr<T[]> slots;
+    size_t mask;
+    alignas(MY_QUEUE_ALIGNMENT) std::atomic<size_t> head{0}; // next slot to pop, written by the consumer
+    size_t cached_tail = 0;
+    alignas(MY_QUEUE_ALIGNMENT) std::atomic<size_t> tail{0}; // next slot to push, written by the producer
+    size_t cached_head = 0;
+    MyQueueWaiter not_empty; // the consumer waits for a value
+    MyQueueWaiter not_full;  // the producer waits for a free slot
+
+public:
+    /// @brief Constructor
+    /// @param capacity Rounded up to a power of 2.
+    explicit MySpscQueue(size_t capacity) : slots(new T[my_round_up_pow2(capacity)]), mask(my_round_up_pow2(capacity) - 1) {}
+    MySpscQueue(const MySpscQueue &) = delete;
+    MySpscQueue &operator=(const MySpscQueue &) = delete;
+
+    /// @brief Producer only.
+    /// @return False if the queue is full.
+    bool try_push(T value)
+    {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - this->cached_head > this->mask)
+        {
+            this->cached_head = this->head.load(std::memory_order_acquire);
+            if (tail - this->cached_head > this->mask)
+            {
+                return false;
+            }
+        }
+        this->slots[tail & this->mask] = std::move(value);
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Consumer only.
+    /// @return False if the queue is empty.
+    bool try_pop(T &value)
+    {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == this->cached_tail)
+        {
+            this->cached_tail = this->tail.load(std::memory_order_acquire);
+            if (head == this->cached_tail)
+            {
+                return false;
+            }
+        }
+        value = std::move(this->slots[head & this->mask]);
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Push a value, waits while the queue is full.
+    void push(T value)
+    {
+        for (int attempt = 0; !try_push(value);)
+        {
+            if (!my_queue_backoff(attempt))
+            {
+                this->not_full.wait([&]()
+                                    { return try_push(value); });
+                break;
+            }
+        }
+        this->not_empty.notify();
+    }
+
+    /// @brief Pop a value, waits while the queue is empty.
+    void pop(T &value)
+    {
+        for (int attempt = 0; !try_pop(value);)
+        {
+            if (!my_queue_backoff(attempt))
+            {
+                this->not_empty.wait([&]()
+                                     { return try_pop(value); });
+                break;
+            }
+        }
+        this->not_full.notify();
+    }
+
+    size_t get_capacity() { return this->mask + 1; }
+};
+
+/// @brief Queue with any number of producer and consumer threads, e.g. several fetch threads and one parse thread.
+/// @details Every slot has a sequence number that tells whether it is free for the push or filled for the pop of
+/// a given round (D. Vyukov's bounded queue). Producers and consumers claim a slot with one compare-exchange on
+/// their index and never wait for each other unless the queue is full or empty.
+template <typename T>
+class MyMpmcQueue
+{
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(MY_QUEUE_ALIGNMENT) std::atomic<size_t> head{0};
+    alignas(MY_QUEUE_ALIGNMENT) std::atomic<size_t> tail{0};
+    MyQueueWaiter not_empty; // consumers wait for a value
+    MyQueueWaiter not_full;  // producers wait for a free slot
+
+public:
+    /// @brief Constructor
+    /// @param capacity Rounded up to a power of 2, at least 2.
+    explicit MyMpmcQueue(size_t capacity) : slots(new Slot[my_round_up_pow2(capacity < 2 ? 2 : capacity)]), mask(my_round_up_pow2(capacity < 2 ? 2 : capacity) - 1)
+    {
+        for (size_t i = 0; i <= this->mask; i++)
+        {
+            this->slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MyMpmcQueue(const MyMpmcQueue &) = delete;
+    MyMpmcQueue &operator=(const MyMpmcQueue &) = delete;
+
+    /// @return False if the queue is full.
+    bool try_push(T value)
+    {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = this->slots[tail & this->mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == tail)
+            {
+                if (this->tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(value);
+                    slot.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if ((ptrdiff_t)(sequence - tail) < 0)
+            {
+                return false; // the slot still holds the value of the previous round
+            }
+            else
+            {
+                tail = this->tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @return False if the queue is empty.
+    bool try_pop(T &value)
+    {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = this->slots[head & this->mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == head + 1)
+            {
+                if (this->head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(slot.value);
+                    slot.sequence.store(head + this->mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if ((ptrdiff_t)(sequence - (head + 1)) < 0)
+            {
+                return false; // the slot has not been filled in this round
+            }
+            else
+            {
+                head = this->head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief Push a value, waits while the queue is full.
+    void push(T value)
+    {
+        for (int attempt = 0; !try_push(value);)
+        {
+            if (!my_queue_backoff(attempt))
+            {
+                this->not_full.wait([&]()
+                                    { return try_push(value); });
+                break;
+            }
+        }
+        this->not_empty.notify();
+    }
+
+    /// @brief Pop a value, waits while the queue is empty.
+    void pop(T &value)
+    {
+        for (int attempt = 0; !try_pop(value);)
+        {
+            if (!my_queue_backoff(attempt))
+            {
+                this->not_empty.wait([&]()
+                                     { return try_pop(value); });
+                break;
+            }
+        }
+        this->not_full.notify();
+    }
+
+    size_t get_capacity() { return this->mask + 1; }
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include "my_aggtrade.h"
+#include "my_trade_buffer.h"
+
+#ifndef __MY_TRADE_AGGREGATOR_H__
+#define __MY_TRADE_AGGREGATOR_H__
+
+// -----------------------------------------------------------
+// Aggregation: OHLCV bars, VWAP and buy/sell volume imbalance of several windows at once, updated trade by trade
+// in O(1) and readable while trades arrive. Prices and volumes are exact ticks, thus the trades must have been
+// parsed with a MyDecimalScale.
+// -----------------------------------------------------------
+
+/// @brief Completed bars kept per window by default, older bars are dropped.
+const size_t MY_AGGREGATOR_HISTORY = 1024;
+/// @brief Slots of the rolling window, its length is exact to 1/MY_AGGREGATOR_SLOTS of the window.
+const size_t MY_AGGREGATOR_SLOTS = 64;
+
+/// @brief Kind of a window: a bar per time interval or per number of trades.
+enum MyWindowType
+{
+    MY_WINDOW_TIME,  // size in milliseconds, bars start at multiples of size since the epoch
+    MY_WINDOW_TRADES // size in trades, counted from the first trade of the aggregator
+};
+
+struct MyWindow
+{
+    MyWindowType type;
+    int64_t size;
+};
+
+/// @brief Sums of a set of trades. Buy volume is the volume of taker buys (BuyerIsMaker == false).
+struct MyTradeTotals
+{
+    uint64_t trade_count = 0;
+    int64_t volume = 0;      // quantity ticks
+    int64_t buy_volume = 0;  // quantity ticks
+    double notional = 0;     // sum of price ticks * quantity ticks
+
+    void add(int64_t price_ticks, int64_t quantity_ticks, bool buyer_is_maker)
+    {
+        this->trade_count++;
+        this->volume += quantity_ticks;
+        this->buy_volume += buyer_is_maker ? 0 : quantity_ticks;
+        this->notional += (double)price_ticks * (double)quantity_ticks;
+    }
+
+    void add(const MyTradeTotals &other)
+    {
+        this->trade_count += other.trade_count;
+        this->volume += other.volume;
+        this->buy_volume += other.buy_volume;
+        this->notional += other.notional;
+    }
+
+    int64_t get_sell_volume() const { return this->volume - this->buy_volume; }
+
+    /// @brief Volume-weighted average price in price ticks, 0 if there is no volume.
+    double get_vwap() const { return this->volume == 0 ? 0 : this->notional / (double)this->volume; }
+
+    /// @brief (buy - sell) / (buy + sell) volume, from -1 (only sells) to 1 (only buys), 0 if there is no volume.
+    double get_imbalance() const { return this->volume == 0 ? 0 : (double)(2 * this->buy_volume - this->volume) / (double)this->volume; }
+};
+
+/// @brief OHLCV bar of a window. Prices are price ticks.
+struct MyBar
+{
+    int64_t start = 0;     // first millisecond or first trade number of the bar
+    int64_t first_time = 0;
+    int64_t last_time = 0;
+    unsigned long long first_id = 0;
+    unsigned long long last_id = 0;
+    int64_t open = 0;
+    int64_t high = 0;
+    int64_t low = 0;
+    int64_t close = 0;
+    MyTradeTotals totals;
+};
+
+/// @brief Aggregates trades into bars and rolling totals of several windows.
+/// @details Per window there is the current bar, a ring of the last completed bars and a ring of
+/// MY_AGGREGATOR_SLOTS partial totals that cover the last window (the rolling VWAP/imbalance). A trade updates
+/// the current bar and one slot of every window, a query sums at most MY_AGGREGATOR_SLOTS slots, thus neither
+/// depends on the number of trades. Trades older than the newest trade (by time) count into the current bar.
+/// Intervals without trades have no bar.
+/// One thread adds the trades, any thread may query meanwhile: a batch of trades holds a write lock once, a query
+/// holds a read lock while it copies, like a shard of MyConcurrentHashTable of part 1.
+class MyTradeAggregator
+{
+private:
+    struct Series
+    {
+        MyWindow window;
+        int64_t slot_width;
+        int64_t slot_count; // slots of the rolling window, at most MY_AGGREGATOR_SLOTS
+        MyBar current;
+        bool has_current = false;
+        std::vector<MyBar> history;  // ring of completed bars
+        size_t history_next = 0;
+        size_t history_count = 0;
+        std::vector<MyTradeTotals> slots; // ring, slot k holds position / slot_width == slot_keys[k]
+        std::vector<int64_t> slot_keys;
+        int64_t last_slot_key = INT64_MIN;
+        int64_t last_position = INT64_MIN;
+    };
+
+    mutable std::shared_mutex lock;
+    std::vector<Series> series;
+    int64_t trade_count = 0;
+
+    static int64_t floor_div(int64_t value, int64_t divisor)
+    {
+        int64_t quotient = value / divisor;
+        return quotient - (value % divisor != 0 && value < 0 ? 1 : 0);
+    }
+
+    static size_t slot_of(int64_t key) { return (size_t)((uint64_t)key % MY_AGGREGATOR_SLOTS); }
+
+    void add_trade(unsigned long long id, int64_t price_ticks, int64_t quantity_ticks, int64_t time, bool buyer_is_maker)
+    {
+        for (Series &s : this->series)
+        {
+            int64_t position = std::max(s.last_position, s.window.type == MY_WINDOW_TIME ? time : this->trade_count);
+            s.last_position = position;
+
+            int64_t start = floor_div(position, s.window.size) * s.window.size;
+            if (!s.has_current || start != s.current.start)
+            {
+                if (s.has_current && !s.history.empty())
+                {
+                    s.history[s.history_next] = s.current;
+                    s.history_next = (s.history_next + 1) % s.history.size();
+                    s.history_count = std::min(s.history_count + 1, s.history.size());
+                }
+                s.current = MyBar();
+                s.current.start = start;
+                s.current.first_time = time;
+                s.current.first_id = id;
+                s.current.open = s.current.high = s.current.low = price_ticks;
+                s.has_current = true;
+            }
+            MyBar &bar = s.current;
+            bar.last_time = time;
+            bar.last_id = id;
+            bar.high = std::max(bar.high, price_ticks);
+            bar.low = std::min(bar.low, price_ticks);
+            bar.close = price_ticks;
+            bar.totals.add(price_ticks, quantity_ticks, buyer_is_maker);
+
+            int64_t key = floor_div(position, s.slot_width);
+            size_t slot = slot_of(key);
+            if (s.slot_keys[slot] != key)
+            {
+                s.slot_keys[slot] = key;
+                s.slots[slot] = MyTradeTotals();
+            }
+            s.slots[slot].add(price_ticks, quantity_ticks, buyer_is_maker);
+            s.last_slot_key = key;
+        }
+        this->trade_count++;
+    }
+
+public:
+    /// @brief Constructor
+    /// @param windows Time and trade windows, e.g. {{MY_WINDOW_TIME, 60000}, {MY_WINDOW_TRADES, 1000}}. A size
+    /// below 1 is taken as 1.
+    /// @param history Completed bars kept per window.
+    explicit MyTradeAggregator(const std::vector<MyWindow> &windows, size_t history = MY_AGGREGATOR_HISTORY)
+    {
+        for (MyWindow window : windows)
+        {
+            Series s;
+            s.window = window;
+            s.window.size = std::max<int64_t>(1, window.size);
+            s.slot_width = (s.window.size + (int64_t)MY_AGGREGATOR_SLOTS - 1) / (int64_t)MY_AGGREGATOR_SLOTS;
+            s.slot_count = (s.window.size + s.slot_width - 1) / s.slot_width;
+            s.history.resize(history);
+            s.slots.resize(MY_AGGREGATOR_SLOTS);
+            s.slot_keys.resize(MY_AGGREGATOR_SLOTS, INT64_MIN);
+            this->series.push_back(std::move(s));
+        }
+    }
+
+    void add(const AggTrade &trade)
+    {
+        std::unique_lock<std::shared_mutex> guard(this->lock);
+        add_trade(trade.AggregateTradeId, trade.PriceTicks, trade.QuantityTicks, (int64_t)trade.Timestamp, trade.BuyerIsMaker);
+    }
+
+    /// @brief Add all trades of the buffer, read column by column and with one lock.
+    void add(const MyTradeBuffer &trades)
+    {
+        std::unique_lock<std::shared_mutex> guard(this->lock);
+        const unsigned long long *ids = trades.get_ids();
+        const int64_t *price_ticks = trades.get_price_ticks();
+        const int64_t *quantity_ticks = trades.get_quantity_ticks();
+        const time_t *timestamps = trades.get_timestamps();
+        for (size_t i = 0; i < trades.size(); i++)
+        {
+            add_trade(ids[i], price_ticks[i], quantity_ticks[i], (int64_t)timestamps[i], trades.is_buyer_maker(i));
+        }
+    }
+
+    size_t get_window_count() const { return this->series.size(); }
+    MyWindow get_window(size_t window) const { return this->series[window].window; }
+
+    uint64_t get_trade_count() const
+    {
+        std::shared_lock<std::shared_mutex> guard(this->lock);
+        return (uint64_t)this->trade_count;
+    }
+
+    /// @brief Get the current (not yet completed) bar of a window.
+    /// @return False if there has been no trade.
+    bool get_bar(size_t window, MyBar &bar) const
+    {
+        std::shared_lock<std::shared_mutex> guard(this->lock);
+        const Series &s = this->series[window];
+        bar = s.current;
+        return s.has_current;
+    }
+
+    /// @brief Get the completed bars of a window, the oldest first.
+    /// @param window
+    /// @param bars Receives at most the history size of bars.
+    /// @return The number of bars.
+    size_t get_bars(size_t window, std::vector<MyBar> &bars) const
+    {
+        std::shared_lock<std::shared_mutex> guard(this->lock);
+        const Series &s = this->series[window];
+        bars.clear();
+        for (size_t i = 0; i < s.history_count; i++)
+        {
+            bars.push_back(s.history[(s.history_next + s.history.size() - s.history_count + i) % s.history.size()]);
+        }
+        return bars.size();
+    }
+
+    /// @brief Get the totals of the last window length, e.g. the rolling VWAP and imbalance of the last minute.
+    /// @details The window ends with the slot of the newest trade (or of now, if later) and reaches back by whole
+    /// slots of size / MY_AGGREGATOR_SLOTS (rounded up), thus its length is exact to one slot. Windows of at most
+    /// MY_AGGREGATOR_SLOTS trades are exact.
+    /// @param window
+    /// @param now Milliseconds since the epoch for time windows, e.g. to let the totals decay while there are no
+    /// trades. INT64_MIN: the time of the newest trade. Ignored by trade windows.
+    MyTradeTotals get_rolling(size_t window, int64_t now = INT64_MIN) const
+    {
+        std::shared_lock<std::shared_mutex> guard(this->lock);
+        const Series &s = this->series[window];
+        MyTradeTotals totals;
+        int64_t newest = s.last_slot_key;
+        if (s.window.type == MY_WINDOW_TIME && now != INT64_MIN)
+        {
+            newest = std::max(newest, floor_div(now, s.slot_width));
+        }
+        for (size_t i = 0; i < MY_AGGREGATOR_SLOTS; i++)
+        {
+            if (s.slot_keys[i] != INT64_MIN && s.slot_keys[i] > newest - s.slot_count)
+            {
+                totals.add(s.slots[i]);
+            }
+        }
+        return totals;
+    }
+};
+
+#endif
@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "my_aggtrade.h"
+#include "my_decimal.h"
+#include "my_hash_policies.h"
+#include "my_mapped_file.h"
+#include "my_trade_buffer.h"
+
+#ifndef __MY_TRADE_ARCHIVE_H__
+#define __MY_TRADE_ARCHIVE_H__
+
+// -----------------------------------------------------------
+// Trade archive: parsed trades in a compact binary file, to keep months of history and to load it without parsing.
+// Layout (byte order of the machine that wrote it): MyArchiveHeader, the blocks, the index (one MyArchiveBlockInfo
+// per block) and MyArchiveFooter. A block holds up to MY_ARCHIVE_BLOCK_TRADES trades column by column:
+// - aggregate ids, first trade ids, timestamps and price ticks: delta to the previous trade, zigzag and varint
+// - last trade ids: last - first, zigzag and varint (mostly 0 to 3, i.e. 1 byte)
+// - quantity ticks: zigzag and varint
+// - buyer is maker: bitmap, 1 bit per trade
+// A trade needs about 10 bytes instead of about 150 as text. The index has the min/max id and time per block, thus
+// a query of a range only decodes the blocks that overlap it.
+// -----------------------------------------------------------
+
+const char MY_ARCHIVE_MAGIC[8] = {'M', 'Y', 'A', 'G', 'G', 'A', 'R', 'C'};
+/// @brief Increased whenever the layout changes, files of other versions are rejected.
+const uint32_t MY_ARCHIVE_VERSION = 1;
+/// @brief Maximum number of trades per block.
+const size_t MY_ARCHIVE_BLOCK_TRADES = 8192;
+/// @brief Number of columns of a block.
+const size_t MY_ARCHIVE_COLUMN_COUNT = 7;
+/// @brief Maximum size of a varint of 64 bits.
+const size_t MY_VARINT_MAX_SIZE = 10;
+
+struct MyArchiveHeader
+{
+    char magic[8];
+    uint32_t version;
+    /// @brief Decimal places of price and quantity (MyDecimalScale) of all trades.
+    uint32_t price_scale;
+    uint32_t quantity_scale;
+    uint32_t reserved;
+};
+
+/// @brief Entry of the index, one per block.
+struct MyArchiveBlockInfo
+{
+    uint64_t offset; // from the start of the file
+    uint32_t size;   // bytes of the block
+    uint32_t trade_count;
+    uint64_t min_id;
+    uint64_t max_id;
+    int64_t min_time;
+    int64_t max_time;
+    uint32_t crc; // CRC-32C of the block
+    uint32_t reserved;
+};
+
+struct MyArchiveFooter
+{
+    uint64_t index_offset;
+    uint64_t block_count;
+    uint64_t trade_count;
+    char magic[8];
+};
+
+/// @brief Map signed to unsigned integers so that small negative numbers are small too: 0, -1, 1, -2 -> 0, 1, 2, 3.
+inline uint64_t my_zigzag_encode(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+inline int64_t my_zigzag_decode(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+/// @brief Write an integer with 7 bits per byte (LEB128), the high bit marks that more bytes follow.
+/// @return Behind the last written byte, at most MY_VARINT_MAX_SIZE bytes.
+inline char *my_varint_write(char *out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (char)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (char)value;
+    return out;
+}
+
+/// @brief Read an integer written by my_varint_write().
+/// @param in Moved behind the integer.
+/// @param end
+/// @param value
+/// @return False if the integer is truncated or too long.
+inline bool my_varint_read(const char *&in, const char *end, uint64_t &value)
+{
+    if (in < end && (unsigned char)*in < 0x80) // 1 byte, the common case
+    {
+        value = (unsigned char)*in++;
+        return true;
+    }
+    value = 0;
+    for (unsigned shift = 0; in < end && shift < 64; shift += 7)
+    {
+        unsigned char byte = (unsigned char)*in++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (byte < 0x80)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Writes trades into an archive file block by block.
+/// @details The trades must have been parsed with the scale of the archive (PriceTicks and QuantityTicks are
+/// stored, see MyAggTradeParser). They are written in the order they are passed on, usually the order of their ids.
+class MyTradeArchiveWriter
+{
+private:
+    std::ofstream file;
+    MyDecimalScale scale = {0, 0};
+    MyTradeBuffer pending;
+    std::vector<MyArchiveBlockInfo> index;
+    std::string block;
+    uint64_t offset = 0;
+    uint64_t trade_count = 0;
+
+    void write_block()
+    {
+        size_t count = this->pending.size();
+        if (count == 0)
+        {
+            return;
+        }
+        const unsigned long long *ids = this->pending.get_ids();
+        const unsigned long long *first_trades = this->pending.get_first_trades();
+        const unsigned long long *last_trades = this->pending.get_last_trades();
+        const time_t *timestamps = this->pending.get_timestamps();
+        const int64_t *price_ticks = this->pending.get_price_ticks();
+        const int64_t *quantity_ticks = this->pending.get_quantity_ticks();
+        const uint64_t *maker_bits = this->pending.get_maker_bits();
+
+        // Column offsets first, then the columns, each at most MY_VARINT_MAX_SIZE bytes per trade.
+        this->block.resize(sizeof(uint32_t) * MY_ARCHIVE_COLUMN_COUNT + count * MY_VARINT_MAX_SIZE * (MY_ARCHIVE_COLUMN_COUNT - 1) + count / 8 + 1);
+        char *begin = &this->block[0];
+        uint32_t column_offsets[MY_ARCHIVE_COLUMN_COUNT];
+        char *out = begin + sizeof(column_offsets);
+        MyArchiveBlockInfo info = {};
+        info.min_id = info.max_id = ids[0];
+        info.min_time = info.max_time = (int64_t)timestamps[0];
+
+        column_offsets[0] = (uint32_t)(out - begin);
+        for (size_t i = 0; i < count; i++)
+        {
+            out = my_varint_write(out, my_zigzag_encode((int64_t)(ids[i] - (i == 0 ? 0 : ids[i - 1]))));
+            info.min_id = std::min<uint64_t>(info.min_id, ids[i]);
+            info.max_id = std::max<uint64_t>(info.max_id, ids[i]);
+        }
+        column_offsets[1] = (uint32_t)(out - begin);
+        for (size_t i = 0; i < count; i++)
+        {
+            out = my_varint_write(out, my_zigzag_encode((int64_t)(first_trades[i] - (i == 0 ? 0 : first_trades[i - 1]))));
+        }
+        column_offsets[2] = (uint32_t)(out - begin);
+        for (size_t i = 0; i < count; i++)
+        {
+            out = my_varint_write(out, my_zigzag_encode((int64_t)(last_trades[i] - first_trades[i])));
+        }
+        column_offsets[3] = (uint32_t)(out - begin);
+        for (size_t i = 0; i < count; i++)
+        {
+            out = my_varint_write(out, my_zigzag_encode((int64_t)((uint64_t)timestamps[i] - (i == 0 ? 0 : (uint64_t)timestamps[i - 1]))));
+            info.min_time = std::min<int64_t>(info.min_time, (int64_t)timestamps[i]);
+            info.max_time = std::max<int64_t>(info.max_time, (int64_t)timestamps[i]);
+        }
+        column_offsets[4] = (uint32_t)(out - begin);
+        for (size_t i = 0; i < count; i++)
+        {
+            out = my_varint_write(out, my_zigzag_encode((int64_t)((uint64_t)price_ticks[i] - (i == 0 ? 0 : (uint64_t)price_ticks[i - 1]))));
+        }
+        column_offsets[5] = (uint32_t)(out - begin);
+        for (size_t i = 0; i < count; i++)
+        {
+            out = my_varint_write(out, my_zigzag_encode(quantity_ticks[i]));
+        }
+        column_offsets[6] = (uint32_t)(out - begin);
+        for (size_t j = 0; j < (count + 7) / 8; j++)
+        {
+            *out++ = (char)(maker_bits[j / 8] >> (8 * (j % 8))); // bit i is bit i % 8 of byte i / 8
+        }
+        memcpy(begin, column_offsets, sizeof(column_offsets));
+
+        info.offset = this->offset;
+        info.size = (uint32_t)(out - begin);
+        info.trade_count = (uint32_t)count;
+        info.crc = my_crc32c(begin, info.size);
+        this->file.write(begin, info.size);
+        this->offset += info.size;
+        this->index.push_back(info);
+        this->pending.clear();
+    }
+
+public:
+    MyTradeArchiveWriter() : pending(MY_ARCHIVE_BLOCK_TRADES) {}
+    MyTradeArchiveWriter(const MyTradeArchiveWriter &) = delete;
+    MyTradeArchiveWriter &operator=(const MyTradeArchiveWriter &) = delete;
+
+    /// @brief Destructor, closes the archive.
+    ~MyTradeArchiveWriter() { close(); }
+
+    /// @brief Create or overwrite an archive.
+    /// @param path
+    /// @param scale Decimal places of price and quantity of the trades.
+    /// @return False if the file cannot be written.
+    bool open(const char *path, MyDecimalScale scale)
+    {
+        close();
+        this->file.open(path, std::ios::binary | std::ios::trunc);
+        this->scale = scale;
+        this->index.clear();
+        this->pending.clear();
+        this->trade_count = 0;
+        MyArchiveHeader header = {};
+        memcpy(header.magic, MY_ARCHIVE_MAGIC, sizeof(header.magic));
+        header.version = MY_ARCHIVE_VERSION;
+        header.price_scale = scale.price;
+        header.quantity_scale = scale.quantity;
+        this->file.write((const char *)&header, sizeof(header));
+        this->offset = sizeof(header);
+        return this->file.good();
+    }
+
+    void write(const AggTrade &trade)
+    {
+        this->pending.push_back(trade);
+        this->trade_count++;
+        if (this->pending.size() == MY_ARCHIVE_BLOCK_TRADES)
+        {
+            write_block();
+        }
+    }
+
+    void write(const MyTradeBuffer &trades)
+    {
+        for (size_t i = 0; i < trades.size(); i++)
+        {
+            write(trades.get(i));
+        }
+    }
+
+    /// @brief Write the last block, the index and the footer and close the file.
+    /// @return False if any write failed or no archive is open.
+    bool close()
+    {
+        if (!this->file.is_open())
+        {
+            return false;
+        }
+        write_block();
+        // The index is read from the mapping in place, thus it starts at a multiple of 8 bytes.
+        char padding[8] = {};
+        size_t padding_size = (size_t)((8 - this->offset % 8) % 8);
+        this->file.write(padding, (std::streamsize)padding_size);
+        this->offset += padding_size;
+        MyArchiveFooter footer = {};
+        footer.index_offset = this->offset;
+        footer.block_count = this->index.size();
+        footer.trade_count = this->trade_count;
+        memcpy(footer.magic, MY_ARCHIVE_MAGIC, sizeof(footer.magic));
+        this->file.write((const char *)this->index.data(), (std::streamsize)(this->index.size() * sizeof(MyArchiveBlockInfo)));
+        this->file.write((const char *)&footer, sizeof(footer));
+        this->file.close();
+        return !this->file.fail();
+    }
+
+    bool is_open() { return this->file.is_open(); }
+    uint64_t get_trade_count() { return this->trade_count; }
+};
+
+/// @brief Reads an archive from a memory mapping, only the blocks that are read are loaded from the disk.
+class MyTradeArchiveReader
+{
+private:
+    MyMappedFile file;
+    MyDecimalScale scale = {0, 0};
+    const MyArchiveBlockInfo *index = nullptr;
+    size_t block_count = 0;
+    uint64_t trade_count = 0;
+    bool verify = true;
+    std::vector<int64_t> columns; // decoded varint columns of read_block()
+    MyTradeBuffer block_trades;   // decoded block of the queries
+
+    /// @brief Decode one zigzag varint column of a block into values (delta: add the previous value).
+    static bool read_column(const char *in, const char *end, size_t count, bool delta, int64_t *values)
+    {
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t value;
+            if (!my_varint_read(in, end, value))
+            {
+                return false;
+            }
+            int64_t decoded = my_zigzag_decode(value);
+            values[i] = delta ? (int64_t)((uint64_t)previous + (uint64_t)decoded) : decoded;
+            previous = values[i];
+        }
+        return true;
+    }
+
+public:
+    MyTradeArchiveReader() : columns((MY_ARCHIVE_COLUMN_COUNT - 1) * MY_ARCHIVE_BLOCK_TRADES), block_trades(MY_ARCHIVE_BLOCK_TRADES) {}
+    MyTradeArchiveReader(const MyTradeArchiveReader &) = delete;
+    MyTradeArchiveReader &operator=(const MyTradeArchiveReader &) = delete;
+
+    /// @brief Map an archive and check its header, footer and index.
+    /// @param path
+    /// @param verify True: check the CRC-32C of every block when it is read.
+    /// @return False if the file cannot be mapped, is of another version or is truncated.
+    bool open(const char *path, bool verify = true)
+    {
+        this->index = nullptr;
+        this->block_count = 0;
+        this->trade_count = 0;
+        this->verify = verify;
+        MyArchiveHeader header;
+        MyArchiveFooter footer;
+        if (!this->file.open(path) || this->file.get_size() < sizeof(header) + sizeof(footer))
+        {
+            this->file.close();
+            return false;
+        }
+        const char *data = this->file.get_data();
+        size_t size = this->file.get_size();
+        memcpy(&header, data, sizeof(header));
+        memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+        if (memcmp(header.magic, MY_ARCHIVE_MAGIC, sizeof(MY_ARCHIVE_MAGIC)) != 0 || header.version != MY_ARCHIVE_VERSION ||
+            memcmp(footer.magic, MY_ARCHIVE_MAGIC, sizeof(MY_ARCHIVE_MAGIC)) != 0 || header.price_scale > MY_DECIMAL_MAX_SCALE ||
+            header.quantity_scale > MY_DECIMAL_MAX_SCALE || footer.index_offset > size - sizeof(footer) ||
+            footer.block_count != (size - sizeof(footer) - footer.index_offset) / sizeof(MyArchiveBlockInfo) ||
+            (size - sizeof(footer) - footer.index_offset) % sizeof(MyArchiveBlockInfo) != 0 ||
+            footer.index_offset % alignof(MyArchiveBlockInfo) != 0)
+        {
+            this->file.close();
+            return false;
+        }
+        this->index = (const MyArchiveBlockInfo *)(data + footer.index_offset);
+        this->block_count = (size_t)footer.block_count;
+        for (size_t i = 0; i < this->block_count; i++)
+        {
+            const MyArchiveBlockInfo &info = this->index[i];
+            if (info.offset < sizeof(header) || info.offset > footer.index_offset || info.size > footer.index_offset - info.offset ||
+                info.trade_count == 0 || info.trade_count > MY_ARCHIVE_BLOCK_TRADES)
+            {
+                this->file.close();
+                this->index = nullptr;
+                this->block_count = 0;
+                return false;
+            }
+        }
+        this->scale = {header.price_scale, header.quantity_scale};
+        this->trade_count = footer.trade_count;
+        return true;
+    }
+
+    /// @brief Decode a block.
+    /// @param block Index of the block, see get_block_count().
+    /// @param trades Cleared and filled with the trades of the block.
+    /// @return False if the block is corrupt (CRC-32C if verified or malformed columns).
+    bool read_block(size_t block, MyTradeBuffer &trades)
+    {
+        trades.clear();
+        if (block >= this->block_count)
+        {
+            return false;
+        }
+        const MyArchiveBlockInfo &info = this->index[block];
+        const char *begin = this->file.get_data() + info.offset;
+        const char *end = begin + info.size;
+        uint32_t column_offsets[MY_ARCHIVE_COLUMN_COUNT];
+        size_t count = info.trade_count;
+        if (info.size < sizeof(column_offsets) || (this->verify && my_crc32c(begin, info.size) != info.crc))
+        {
+            return false;
+        }
+        memcpy(column_offsets, begin, sizeof(column_offsets));
+        for (size_t c = 0; c < MY_ARCHIVE_COLUMN_COUNT; c++)
+        {
+            if (column_offsets[c] > info.size)
+            {
+                return false;
+            }
+        }
+        if (info.size - column_offsets[6] < (count + 7) / 8)
+        {
+            return false;
+        }
+
+        // Decode column by column, then append the trades.
+        int64_t *columns[MY_ARCHIVE_COLUMN_COUNT - 1];
+        const bool DELTA[] = {true, true, false, true, true, false};
+        for (size_t c = 0; c < MY_ARCHIVE_COLUMN_COUNT - 1; c++)
+        {
+            columns[c] = this->columns.data() + c * MY_ARCHIVE_BLOCK_TRADES;
+            if (!read_column(begin + column_offsets[c], end, count, DELTA[c], columns[c]))
+            {
+                return false;
+            }
+        }
+        const unsigned char *maker_bits = (const unsigned char *)begin + column_offsets[6];
+        AggTrade trade = {};
+        for (size_t i = 0; i < count; i++)
+        {
+            trade.AggregateTradeId = (unsigned long long)columns[0][i];
+            trade.FirstTrade = (unsigned long long)columns[1][i];
+            trade.LastTrade = trade.FirstTrade + (unsigned long long)columns[2][i];
+            trade.Timestamp = (time_t)columns[3][i];
+            trade.PriceTicks = columns[4][i];
+            trade.QuantityTicks = columns[5][i];
+            trade.Price = my_decimal_to_double(trade.PriceTicks, this->scale.price);
+            trade.Quantity = my_decimal_to_double(trade.QuantityTicks, this->scale.quantity);
+            trade.BuyerIsMaker = (maker_bits[i / 8] >> (i % 8)) & 1;
+            trades.push_back(trade);
+        }
+        return true;
+    }
+
+    /// @brief Pass on all trades with a timestamp in [from_time, to_time], blocks outside of it are not decoded.
+    /// @param from_time Milliseconds since the epoch.
+    /// @param to_time
+    /// @param on_trade Called with const AggTrade & in the order of the archive.
+    /// @return False if a block is corrupt, the trades before it have been passed on.
+    template <typename OnTrade>
+    bool query_time(int64_t from_time, int64_t to_time, OnTrade on_trade)
+    {
+        for (size_t b = 0; b < this->block_count; b++)
+        {
+            if (this->index[b].max_time < from_time || this->index[b].min_time > to_time)
+            {
+                continue;
+            }
+            if (!read_block(b, this->block_trades))
+            {
+                return false;
+            }
+            const time_t *timestamps = this->block_trades.get_timestamps();
+            for (size_t i = 0; i < this->block_trades.size(); i++)
+            {
+                if ((int64_t)timestamps[i] >= from_time && (int64_t)timestamps[i] <= to_time)
+                {
+                    on_trade(this->block_trades.get(i));
+                }
+            }
+        }
+        return true;
+    }
+
+    /// @brief Pass on all trades with an aggregate id in [from_id, to_id], see query_time().
+    template <typename OnTrade>
+    bool query_ids(unsigned long long from_id, unsigned long long to_id, OnTrade on_trade)
+    {
+        for (size_t b = 0; b < this->block_count; b++)
+        {
+            if (this->index[b].max_id < from_id || this->index[b].min_id > to_id)
+            {
+                continue;
+            }
+            if (!read_block(b, this->block_trades))
+            {
+                return false;
+            }
+            const unsigned long long *ids = this->block_trades.get_ids();
+            for (size_t i = 0; i < this->block_trades.size(); i++)
+            {
+                if (ids[i] >= from_id && ids[i] <= to_id)
+                {
+                    on_trade(this->block_trades.get(i));
+                }
+            }
+        }
+        return true;
+    }
+
+    size_t get_block_count() { return this->block_count; }
+    const MyArchiveBlockInfo &get_block_info(size_t block) { return this->index[block]; }
+    uint64_t get_trade_count() { return this->trade_count; }
+    size_t get_file_size() { return this->file.get_size(); }
+    MyDecimalScale get_scale() { return this->scale; }
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include "my_aggtrade.h"
+
+#ifndef __MY_TRADE_BUFFER_H__
+#define __MY_TRADE_BUFFER_H__
+
+/// @brief Alignment of every column, a cache line.
+const size_t MY_TRADE_BUFFER_ALIGNMENT = 64;
+/// @brief Minimum capacity, one response of GET /fapi/v1/aggTrades has at most 1000 trades.
+const size_t MY_TRADE_BUFFER_MIN_CAPACITY = 1024;
+
+/// @brief Trades in struct-of-arrays layout: one contiguous column per field and a bitset for BuyerIsMaker.
+/// @details All columns live in one allocation that is kept by clear(), thus a buffer that is reused for every
+/// response does not allocate once it is large enough. A scan over one field (e.g. the quantities) reads only
+/// that column, which the compiler can vectorize. Reading the trades does not remove them.
+class MyTradeBuffer
+{
+private:
+    char *memory = nullptr;
+    size_t capacity = 0;
+    size_t count = 0;
+    unsigned long long *ids = nullptr;
+    double *prices = nullptr;
+    double *quantities = nullptr;
+    int64_t *price_ticks = nullptr;
+    int64_t *quantity_ticks = nullptr;
+    unsigned long long *first_trades = nullptr;
+    unsigned long long *last_trades = nullptr;
+    time_t *timestamps = nullptr;
+    uint64_t *maker_bits = nullptr;
+
+    /// @brief Move the trades into a new allocation of the given capacity (multiple of 64).
+    void allocate(size_t new_capacity)
+    {
+        // Every column has a multiple of 64 entries of 8 bytes, thus all columns start at a multiple of MY_TRADE_BUFFER_ALIGNMENT.
+        static_assert(sizeof(time_t) <= 8 && sizeof(unsigned long long) == 8, "Every column must fit into 8 bytes per trade");
+        size_t column_size = new_capacity * 8;
+        char *new_memory = (char *)::operator new(8 * column_size + new_capacity / 8, std::align_val_t(MY_TRADE_BUFFER_ALIGNMENT));
+        char *column = new_memory;
+        auto move_column = [&](auto *&values)
+        {
+            auto *new_values = (std::remove_reference_t<decltype(values)>)column;
+            if (this->count > 0)
+            {
+                memcpy(new_values, values, this->count * sizeof(*values));
+            }
+            values = new_values;
+            column += column_size;
+        };
+        move_column(this->ids);
+        move_column(this->prices);
+        move_column(this->quantities);
+        move_column(this->price_ticks);
+        move_column(this->quantity_ticks);
+        move_column(this->first_trades);
+        move_column(this->last_trades);
+        move_column(this->timestamps);
+        uint64_t *new_maker_bits = (uint64_t *)column;
+        if (this->count > 0)
+        {
+            memcpy(new_maker_bits, this->maker_bits, (this->count + 63) / 64 * sizeof(uint64_t));
+        }
+        this->maker_bits = new_maker_bits;
+        release();
+        this->memory = new_memory;
+        this->capacity = new_capacity;
+    }
+
+    void release()
+    {
+        if (this->memory != nullptr)
+        {
+            ::operator delete(this->memory, std::align_val_t(MY_TRADE_BUFFER_ALIGNMENT));
+            this->memory = nullptr;
+        }
+    }
+
+public:
+    MyTradeBuffer() = default;
+    MyTradeBuffer(const MyTradeBuffer &) = delete;
+    MyTradeBuffer &operator=(const MyTradeBuffer &) = delete;
+
+    /// @brief Constructor
+    /// @param capacity Number of trades that fit without allocating again.
+    explicit MyTradeBuffer(size_t capacity) { reserve(capacity); }
+
+    /// @brief Destructor
+    ~MyTradeBuffer() { release(); }
+
+    /// @brief Make room for at least the given number of trades.
+    void reserve(size_t new_capacity)
+    {
+        if (new_capacity > this->capacity)
+        {
+            allocate((std::max(new_capacity, MY_TRADE_BUFFER_MIN_CAPACITY) + 63) / 64 * 64);
+        }
+    }
+
+    /// @brief Remove all trades, the memory is kept for the next response.
+    void clear() { this->count = 0; }
+
+    /// @brief Append a trade, the capacity is doubled if it is full.
+    void push_back(const AggTrade &trade)
+    {
+        if (this->count == this->capacity)
+        {
+            reserve(this->capacity == 0 ? MY_TRADE_BUFFER_MIN_CAPACITY : 2 * this->capacity);
+        }
+        size_t i = this->count++;
+        this->ids[i] = trade.AggregateTradeId;
+        this->prices[i] = trade.Price;
+        this->quantities[i] = trade.Quantity;
+        this->price_ticks[i] = trade.PriceTicks;
+        this->quantity_ticks[i] = trade.QuantityTicks;
+        this->first_trades[i] = trade.FirstTrade;
+        this->last_trades[i] = trade.LastTrade;
+        this->timestamps[i] = trade.Timestamp;
+        uint64_t bit = 1ull << (i % 64);
+        this->maker_bits[i / 64] = (this->maker_bits[i / 64] & ~bit) | (trade.BuyerIsMaker ? bit : 0);
+    }
+
+    /// @brief Get a copy of the trade at the given index (0 = first trade).
+    AggTrade get(size_t index) const
+    {
+        AggTrade trade;
+        trade.AggregateTradeId = this->ids[index];
+        trade.Price = this->prices[index];
+        trade.Quantity = this->quantities[index];
+        trade.FirstTrade = this->first_trades[index];
+        trade.LastTrade = this->last_trades[index];
+        trade.Timestamp = this->timestamps[index];
+        trade.BuyerIsMaker = is_buyer_maker(index);
+        trade.PriceTicks = this->price_ticks[index];
+        trade.QuantityTicks = this->quantity_ticks[index];
+        return trade;
+    }
+
+    bool is_buyer_maker(size_t index) const { return (this->maker_bits[index / 64] >> (index % 64)) & 1; }
+
+    /// @brief Volume-weighted average price of all trades, 0 if empty.
+    /// @details Scans the price and quantity columns with 4 independent sums, so that the additions do not wait for
+    /// each other and the compiler may use SIMD (a single sum cannot be reordered without -ffast-math).
+    double get_vwap() const
+    {
+        double notional[4] = {0, 0, 0, 0};
+        double volume[4] = {0, 0, 0, 0};
+        size_t i = 0;
+        for (; i + 4 <= this->count; i += 4)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                notional[j] += this->prices[i + j] * this->quantities[i + j];
+                volume[j] += this->quantities[i + j];
+            }
+        }
+        for (; i < this->count; i++)
+        {
+            notional[0] += this->prices[i] * this->quantities[i];
+            volume[0] += this->quantities[i];
+        }
+        double total_volume = (volume[0] + volume[1]) + (volume[2] + volume[3]);
+        return total_volume == 0 ? 0 : ((notional[0] + notional[1]) + (notional[2] + notional[3])) / total_volume;
+    }
+
+    size_t size() const { return this->count; }
+    bool empty() const { return this->count == 0; }
+    size_t get_capacity() const { return this->capacity; }
+
+    // Columns, valid until the next push_back() or reserve() that grows the buffer.
+    const unsigned long long *get_ids() const { return this->ids; }
+    const double *get_prices() const { return this->prices; }
+    const double *get_quantities() const { return this->quantities; }
+    const int64_t *get_price_ticks() const { return this->price_ticks; }
+    const int64_t *get_quantity_ticks() const { return this->quantity_ticks; }
+    const unsigned long long *get_first_trades() const { return this->first_trades; }
+    const unsigned long long *get_last_trades() const { return this->last_trades; }
+    const time_t *get_timestamps() const { return this->timestamps; }
+    /// @brief BuyerIsMaker of trade i is bit i % 64 of word i / 64.
+    const uint64_t *get_maker_bits() const { return this->maker_bits; }
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include "my_aggtrade.h"
+#include "my_decimal.h"
+#include "my_trade_buffer.h"
+
+#ifndef __MY_TRADE_FORMATTER_H__
+#define __MY_TRADE_FORMATTER_H__
+
+/// @brief Default size of MyOutputBuffer, the output reaches the stream in blocks of this size.
+const size_t MY_OUTPUT_BUFFER_SIZE = 1 << 20;
+/// @brief Space reserved per trade by MyTradeFormatter: 2 doubles with 8 fixed decimals (up to 320 characters each
+/// for huge values), 4 integers and the field names.
+const size_t MY_FORMATTER_MAX_TRADE_SIZE = 1024;
+/// @brief Maximum length of a double with 8 fixed decimals, see MY_FORMATTER_MAX_TRADE_SIZE.
+const size_t MY_FORMATTER_MAX_DOUBLE_SIZE = 320;
+
+/// @brief Collects the output in a large buffer and passes it on to the stream with one write() per full buffer
+/// instead of one operator<< per value. The stream's formatting state (precision, locale) is not used.
+class MyOutputBuffer
+{
+private:
+    std::ostream *out;
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+    size_t capacity;
+
+public:
+    /// @brief Constructor
+    /// @param out Receives the output, must outlive the buffer.
+    /// @param capacity At least MY_FORMATTER_MAX_TRADE_SIZE if used by MyTradeFormatter.
+    explicit MyOutputBuffer(std::ostream &out, size_t capacity = MY_OUTPUT_BUFFER_SIZE)
+        : out(&out), data(new char[capacity]), capacity(capacity) {}
+    MyOutputBuffer(const MyOutputBuffer &) = delete;
+    MyOutputBuffer &operator=(const MyOutputBuffer &) = delete;
+    ~MyOutputBuffer() { flush(); }
+
+    /// @brief Get the write position for at most n bytes (n <= capacity), the buffer is flushed if they do not fit.
+    /// Complete the write with commit().
+    char *reserve(size_t n)
+    {
+        if (this->capacity - this->size < n)
+        {
+            flush();
+        }
+        return this->data.get() + this->size;
+    }
+
+    /// @brief Complete a write started with reserve().
+    /// @param end Behind the last byte written.
+    void commit(char *end) { this->size = (size_t)(end - this->data.get()); }
+
+    void append(char c)
+    {
+        if (this->size == this->capacity)
+        {
+            flush();
+        }
+        this->data[this->size++] = c;
+    }
+
+    void append(std::string_view text)
+    {
+        if (text.size() > this->capacity - this->size)
+        {
+            flush();
+            if (text.size() > this->capacity)
+            {
+                this->out->write(text.data(), (std::streamsize)text.size()); // too large to copy
+                return;
+            }
+        }
+        memcpy(this->data.get() + this->size, text.data(), text.size());
+        this->size += text.size();
+    }
+
+    /// @brief Pass the buffered bytes on to the stream.
+    void flush()
+    {
+        if (this->size > 0)
+        {
+            this->out->write(this->data.get(), (std::streamsize)this->size);
+            this->size = 0;
+        }
+    }
+};
+
+/// @brief Output format of MyTradeFormatter.
+enum MyOutputFormat
+{
+    MY_FORMAT_PRETTY_JSON, // indented JSON array, like option 1 prints the response
+    MY_FORMAT_NDJSON,      // one compact JSON object per line, like the objects of the API
+    MY_FORMAT_CSV          // header line and one line per trade
+};
+
+/// @brief The constant text around the values of a trade, per format.
+struct MyFormatTemplate
+{
+    std::string_view begin;         // before the first trade
+    std::string_view separator;     // between two trades
+    std::string_view end;           // behind the last trade
+    std::string_view empty_end;     // behind begin if there is no trade
+    std::string_view id;            // before the aggregate trade id
+    std::string_view price;         // before the price
+    std::string_view quantity;      // before the quantity
+    std::string_view first;         // before the first trade id
+    std::string_view last;          // before the last trade id
+    std::string_view time;          // before the timestamp
+    std::string_view maker;         // before the maker flag
+    std::string_view maker_true;    // the flag and everything up to the end of the trade
+    std::string_view maker_false;
+};
+
+const MyFormatTemplate MY_FORMAT_TEMPLATES[] = {
+    {"[\n", ",\n", "\n]\n", "]\n", "  {\n    \"a\": ", ",\n    \"p\": \"", "\",\n    \"q\": \"", "\",\n    \"f\": ",
+     ",\n    \"l\": ", ",\n    \"T\": ", ",\n    \"m\": ", "true\n  }", "false\n  }"},
+    {"", "", "", "", "{\"a\":", ",\"p\":\"", "\",\"q\":\"", "\",\"f\":", ",\"l\":", ",\"T\":", ",\"m\":",
+     "true}\n", "false}\n"},
+    {"aggregate_trade_id,price,quantity,first_trade_id,last_trade_id,timestamp,buyer_is_maker\n", "", "", "",
+     "", ",", ",", ",", ",", ",", ",", "true\n", "false\n"}};
+
+/// @brief Writes trades as pretty JSON, NDJSON or CSV into a MyOutputBuffer.
+/// @details Every trade is written with raw pointers into space reserved once per trade: the constant text comes
+/// from a MyFormatTemplate, the numbers are converted with std::to_chars (no locale, no stream state) and exact
+/// prices/quantities with my_format_decimal. Pretty JSON has the layout of print_aggtrade_json().
+class MyTradeFormatter
+{
+private:
+    MyOutputBuffer buffer;
+    const MyFormatTemplate *format;
+    MyDecimalScale scale;
+    bool exact;
+    bool started = false;
+    bool finished = false;
+    size_t trade_count = 0;
+
+    static char *put(char *position, std::string_view text)
+    {
+        memcpy(position, text.data(), text.size());
+        return position + text.size();
+    }
+
+    static char *put(char *position, unsigned long long value)
+    {
+        return std::to_chars(position, position + 20, value).ptr;
+    }
+
+    /// @brief Write a double with 8 fixed decimal places, like printf("%.8f").
+    /// @details Fast path: value * 10^8 is rounded to an integer and printed with my_format_decimal(). Below 2^50
+    /// the product is off by at most 1/8, thus the result is the correctly rounded one unless the product is close
+    /// to a half (which a price with at most 8 decimal places never is). Other values use std::to_chars.
+    static char *put(char *position, double value)
+    {
+        double scaled = value * 1e8;
+        if (std::fabs(scaled) < 1125899906842624.0) // 2^50
+        {
+            double rounded = std::round(scaled);
+            if (std::fabs(scaled - rounded) < 0.25 && (rounded != 0 || !std::signbit(value)))
+            {
+                return position + my_format_decimal((int64_t)rounded, 8, position);
+            }
+        }
+        std::to_chars_result result = std::to_chars(position, position + MY_FORMATTER_MAX_DOUBLE_SIZE, value, std::chars_format::fixed, 8);
+        return result.ec == std::errc() ? result.ptr : put(position, std::string_view("nan"));
+    }
+
+    void start()
+    {
+        if (!this->started)
+        {
+            this->buffer.append(this->format->begin);
+            this->started = true;
+        }
+    }
+
+    /// @brief Write one trade, the prices as ticks if the formatter is exact and as double otherwise.
+    void write_trade(unsigned long long id, double price, double quantity, int64_t price_ticks, int64_t quantity_ticks,
+                     unsigned long long first, unsigned long long last, long long time, bool buyer_is_maker)
+    {
+        const MyFormatTemplate &format = *this->format;
+        char *p = this->buffer.reserve(MY_FORMATTER_MAX_TRADE_SIZE);
+        if (this->trade_count++ > 0)
+        {
+            p = put(p, format.separator);
+        }
+        p = put(put(p, format.id), id);
+        p = put(p, format.price);
+        p = this->exact ? p + my_format_decimal(price_ticks, this->scale.price, p) : put(p, price);
+        p = put(p, format.quantity);
+        p = this->exact ? p + my_format_decimal(quantity_ticks, this->scale.quantity, p) : put(p, quantity);
+        p = put(put(p, format.first), first);
+        p = put(put(p, format.last), last);
+        p = put(p, format.time);
+        p = time < 0 ? put(put(p, std::string_view("-")), (unsigned long long)-time) : put(p, (unsigned long long)time);
+        p = put(put(p, format.maker), buyer_is_maker ? format.maker_true : format.maker_false);
+        this->buffer.commit(p);
+    }
+
+public:
+    /// @brief Formatter of prices and quantities as double with 8 decimal places.
+    /// @param out Receives the output, must outlive the formatter.
+    /// @param format
+    MyTradeFormatter(std::ostream &out, MyOutputFormat format)
+        : buffer(out), format(&MY_FORMAT_TEMPLATES[format]), scale{0, 0}, exact(false) {}
+
+    /// @brief Formatter of exact prices and quantities (PriceTicks/QuantityTicks), i.e. as they were received.
+    /// @param out Receives the output, must outlive the formatter.
+    /// @param format
+    /// @param scale Decimal places of price and quantity the trades were parsed with.
+    MyTradeFormatter(std::ostream &out, MyOutputFormat format, MyDecimalScale scale)
+        : buffer(out), format(&MY_FORMAT_TEMPLATES[format]), scale(scale), exact(true) {}
+
+    ~MyTradeFormatter() { finish(); }
+
+    void write(const AggTrade &trade)
+    {
+        if (this->finished)
+        {
+            return;
+        }
+        start();
+        write_trade(trade.AggregateTradeId, trade.Price, trade.Quantity, trade.PriceTicks, trade.QuantityTicks,
+                    trade.FirstTrade, trade.LastTrade, (long long)trade.Timestamp, trade.BuyerIsMaker);
+    }
+
+    /// @brief Write all trades of the buffer, read column by column.
+    void write(const MyTradeBuffer &trades)
+    {
+        if (this->finished)
+        {
+            return;
+        }
+        start();
+        const unsigned long long *ids = trades.get_ids();
+        const double *prices = trades.get_prices();
+        const double *quantities = trades.get_quantities();
+        const int64_t *price_ticks = trades.get_price_ticks();
+        const int64_t *quantity_ticks = trades.get_quantity_ticks();
+        const unsigned long long *first_trades = trades.get_first_trades();
+        const unsigned long long *last_trades = trades.get_last_trades();
+        const time_t *timestamps = trades.get_timestamps();
+        for (size_t i = 0; i < trades.size(); i++)
+        {
+            write_trade(ids[i], prices[i], quantities[i], price_ticks[i], quantity_ticks[i], first_trades[i],
+                        last_trades[i], (long long)timestamps[i], trades.is_buyer_maker(i));
+        }
+    }
+
+    /// @brief Write the end of the output (e.g. "]" of pretty JSON) and flush it, later trades are ignored.
+    void finish()
+    {
+        if (!this->finished)
+        {
+            start();
+            this->buffer.append(this->trade_count > 0 ? this->format->end : this->format->empty_end);
+            this->buffer.flush();
+            this->finished = true;
+        }
+    }
+
+    /// @brief Pass the trades written so far on to the stream, e.g. to show progress.
+    void flush() { this->buffer.flush(); }
+
+    size_t get_trade_count() { return this->trade_count; }
+};
+
+#endif
@@ -0,0 +1,738 @@
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <cpr/cpr.h>
+#include "my_adaptive_parser.h"
+#include "my_aggtrade.h"
+#include "my_aggtrade_capture.h"
+#include "my_aggtrade_generator.h"
+#include "my_aggtrade_parser.h"
+#include "my_aggtrade_stream_parser.h"
+#include "my_backfill.h"
+#include "my_cpr_fetcher.h"
+#include "my_multi_symbol.h"
+#include "my_pipeline.h"
+#include "my_trade_aggregator.h"
+#include "my_trade_archive.h"
+#include "my_trade_buffer.h"
+#include "my_trade_formatter.h"
+
+using namespace std;
+
+const bool REDIRECT_FILEOUT = true; // True: redirect cout to FILE_NAME; False: keep default
+const string FILE_NAME = "out.txt";
+const int LIMIT = 500; // Allowed values: [1, 1000]
+const string SYMBOL = "BTCUSDT";
+const string BASE_URL = "https://fapi.binance.com"; // Default of --base-url, e.g. http://127.0.0.1:8080 for the mock server
+const MyDecimalScale SCALE = {2, 3}; // Decimal places of price and quantity of SYMBOL, see GET /fapi/v1/exchangeInfo
+const size_t SYNTHETIC_CHUNK_SIZE = 16384; // Chunk size of --synthetic, like the chunks of curl
+const unsigned BACKFILL_THREADS = 4; // Default of --threads
+const MyOutputFormat OUTPUT_FORMAT = MY_FORMAT_PRETTY_JSON; // Default of --format (json, ndjson or csv) of the options 2 and 3
+const unsigned MULTI_SYMBOL_POLL_INTERVAL_MS = 1000; // Time between two polls of --symbols
+const vector<MyWindow> AGGREGATION_WINDOWS = {{MY_WINDOW_TIME, 1000}, {MY_WINDOW_TIME, 60000}, {MY_WINDOW_TRADES, 100}, {MY_WINDOW_TRADES, 1000}}; // Bars of option 3 and of the backfill
+const char USAGE[] = "Usage: part2 [--base-url URL] [--format json|ndjson|csv] [--archive FILE] [--record FILE | --replay FILE [--paced] | --synthetic COUNT | --backfill FROM_ID TO_ID [--threads N] [--pipeline [--pin]] | --load-archive FILE [--time-range FROM TO] | --symbols SYMBOL[:PRICE_DECIMALS:QUANTITY_DECIMALS],... [--polls N] [--threads N]]";
+
+size_t print_aggtrade_json(const string &json, ostream &out);
+void print_aggtrades(const MyTradeBuffer &trades, MyOutputFormat format, ostream &out);
+void print_aggtrades(const MyTradeBuffer &trades, MyDecimalScale scale, MyOutputFormat format, ostream &out);
+bool parse_aggtrade_json(const string &json, MyTradeBuffer &trades, MyAdaptiveAggTradeParser &parser);
+void run_backfill(const string &base_url, unsigned long long from_id, unsigned long long to_id, unsigned threads, const string &archive_file, ostream &out);
+void run_pipeline(const string &base_url, unsigned long long from_id, unsigned long long to_id, unsigned threads, bool pin, MyOutputFormat format, const string &archive_file, ostream &out);
+bool load_archive(const string &archive_file, int64_t from_time, int64_t to_time, MyOutputFormat format, ostream &out);
+void print_aggregation(const MyTradeAggregator &aggregator, MyDecimalScale scale, ostream &out);
+void run_multi_symbol(const string &base_url, const string &symbols, unsigned polls, unsigned threads, ostream &out);
+
+int main(int argc, char **argv)
+{
+    using chrono_clock = std::chrono::high_resolution_clock;
+    using chrono_tp = std::chrono::high_resolution_clock::time_point;
+    using chrono_ms = std::chrono::milliseconds;
+    using std::chrono::duration;
+    using std::chrono::duration_cast;
+
+    // Source of the response: live (default), live and recorded to a capture file, replayed from a capture file
+    // (as fast as possible or at the recorded pacing) or generated. --backfill downloads a range of ids instead.
+    string base_url = BASE_URL;
+    string record_file;
+    string replay_file;
+    bool paced = false;
+    size_t synthetic_count = 0;
+    bool backfill = false;
+    unsigned long long backfill_from = 0;
+    unsigned long long backfill_to = 0;
+    unsigned threads = BACKFILL_THREADS;
+    bool pipeline = false; // --pipeline: the backfill runs as fetch -> parse -> sink stages and prints the trades
+    bool pin = false;
+    MyOutputFormat format = OUTPUT_FORMAT;
+    string archive_file;      // --archive: the parsed trades are also stored in this archive
+    string load_archive_file; // --load-archive: the trades are read from this archive instead
+    string symbols;           // --symbols: poll the new trades of these symbols instead
+    unsigned polls = 1;
+    int64_t from_time = INT64_MIN;
+    int64_t to_time = INT64_MAX;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc)
+        {
+            record_file = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replay_file = argv[++i];
+        }
+        else if (arg == "--paced")
+        {
+            paced = true;
+        }
+        else if (arg == "--synthetic" && i + 1 < argc)
+        {
+            synthetic_count = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--base-url" && i + 1 < argc)
+        {
+            base_url = argv[++i];
+        }
+        else if (arg == "--backfill" && i + 2 < argc)
+        {
+            backfill = true;
+            backfill_from = strtoull(argv[++i], nullptr, 10);
+            backfill_to = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--pipeline")
+        {
+            pipeline = true;
+        }
+        else if (arg == "--pin")
+        {
+            pin = true;
+        }
+        else if (arg == "--archive" && i + 1 < argc)
+        {
+            archive_file = argv[++i];
+        }
+        else if (arg == "--load-archive" && i + 1 < argc)
+        {
+            load_archive_file = argv[++i];
+        }
+        else if (arg == "--symbols" && i + 1 < argc)
+        {
+            symbols = argv[++i];
+        }
+        else if (arg == "--polls" && i + 1 < argc)
+        {
+            polls = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--time-range" && i + 2 < argc)
+        {
+            from_time = strtoll(argv[++i], nullptr, 10);
+            to_time = strtoll(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--format" && i + 1 < argc && (string(argv[i + 1]) == "json" || string(argv[i + 1]) == "ndjson" || string(argv[i + 1]) == "csv"))
+        {
+            arg = argv[++i];
+            format = arg == "json" ? MY_FORMAT_PRETTY_JSON : (arg == "ndjson" ? MY_FORMAT_NDJSON : MY_FORMAT_CSV);
+        }
+        else
+        {
+            cerr << USAGE << endl;
+            return 1;
+        }
+    }
+
+    ostream *output_stream;
+    if (REDIRECT_FILEOUT)
+    {
+        output_stream = new ofstream(FILE_NAME);
+    }
+    else
+    {
+        output_stream = &cout;
+    }
+
+    *output_stream << "--- Part 2 ---\n";
+    if (backfill || !load_archive_file.empty() || !symbols.empty())
+    {
+        bool ok = true;
+        if (!symbols.empty())
+        {
+            run_multi_symbol(base_url, symbols, polls, threads, *output_stream);
+        }
+        else if (backfill && pipeline)
+        {
+            run_pipeline(base_url, backfill_from, backfill_to, threads, pin, format, archive_file, *output_stream);
+        }
+        else if (backfill)
+        {
+            run_backfill(base_url, backfill_from, backfill_to, threads, archive_file, *output_stream);
+        }
+        else
+        {
+            ok = load_archive(load_archive_file, from_time, to_time, format, *output_stream);
+        }
+        if (REDIRECT_FILEOUT)
+        {
+            delete output_stream; // flush and close the file
+            cout << "Part 2 done, see: " << FILE_NAME << endl;
+        }
+        return ok ? 0 : 1;
+    }
+    stringstream stats_stream;
+
+    // ---------------------------------------------------------------------------------------------------------
+    // Option 4: parse while downloading (or replaying), the trades are complete when the download is
+    // ---------------------------------------------------------------------------------------------------------
+
+    MyAggTradeStreamParser stream_parser(SCALE);
+    MyTradeBuffer stream_trades(max<size_t>(LIMIT, synthetic_count));
+    string data; // the whole response, only kept for the options 1-3
+    size_t chunk_count = 0;
+    duration<double, std::milli> stream_parse_ms(0);
+    duration<double, std::milli> first_trade_ms(0);
+    string synthetic_json = synthetic_count > 0 ? MyAggTradeGenerator().generate_response(synthetic_count) : string();
+    chrono_tp stream_t1 = chrono_clock::now();
+    auto on_chunk = [&](string_view chunk) -> bool
+    {
+        chrono_tp chunk_t1 = chrono_clock::now();
+        chunk_count++;
+        data.append(chunk);
+        bool ok = stream_parser.feed(chunk, [&](const AggTrade &trade)
+                                     {
+            if (stream_trades.empty())
+            {
+                first_trade_ms = chrono_clock::now() - stream_t1;
+            }
+            stream_trades.push_back(trade); });
+        stream_parse_ms += chrono_clock::now() - chunk_t1;
+        return ok; // false aborts the download
+    };
+    string fetch_error;
+    if (!replay_file.empty())
+    {
+        MyCaptureReplay replay;
+        if (replay.open(replay_file.c_str()))
+        {
+            replay.replay(on_chunk, []()
+                          { return false; }, paced); // only the first response
+        }
+        else
+        {
+            fetch_error = "cannot open the capture file " + replay_file;
+        }
+    }
+    else if (synthetic_count > 0)
+    {
+        for (size_t i = 0; i < synthetic_json.size() && on_chunk(string_view(synthetic_json).substr(i, SYNTHETIC_CHUNK_SIZE)); i += SYNTHETIC_CHUNK_SIZE)
+        {
+        }
+    }
+    else
+    {
+        MyCaptureWriter capture;
+        if (!record_file.empty() && !capture.open(record_file.c_str()))
+        {
+            cerr << "ERROR: Cannot write the capture file " << record_file << endl;
+        }
+        string url = base_url + "/fapi/v1/aggTrades?symbol=" + SYMBOL + "&limit=" + to_string(LIMIT);
+        cpr::Response r = cpr::Get(cpr::Url{url}, cpr::WriteCallback{[&](string_view chunk, intptr_t) -> bool
+                                                                      {
+            if (capture.is_open())
+            {
+                capture.write_chunk(chunk);
+            }
+            return on_chunk(chunk); }});
+        fetch_error = r.error.message;
+        if (capture.is_open())
+        {
+            capture.end_response();
+            if (!capture.close())
+            {
+                cerr << "ERROR: Cannot write the capture file " << record_file << endl;
+            }
+        }
+    }
+    duration<double, std::milli> stream_ms = chrono_clock::now() - stream_t1;
+    if (!stream_parser.is_complete())
+    {
+        cerr << "ERROR: Option 4 could not parse the response (" << fetch_error << ")!" << endl;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------
+    // Option 1
+    // ---------------------------------------------------------------------------------------------------------
+
+    chrono_tp print_t1 = chrono_clock::now();
+    *output_stream << "AggTrades Option 1:\n";
+    size_t trade_count = print_aggtrade_json(data, *output_stream);
+    chrono_tp print_t2 = chrono_clock::now();
+    // duration print_ms = duration_cast<chrono_ms>(print_t2 - print_t1); // milliseconds as  int
+    duration<double, std::milli> print_ms = print_t2 - print_t1; // milliseconds as double
+
+    stats_stream << "\n--------------------------------\n"
+                 << "Option 1: \"Print-Parser\"\n"
+                 << "---\n"
+                 << "Total Time: " << print_ms.count() << "ms\n"
+                 << "Nr. of AggTrade: " << trade_count << '\n'
+                 << "Time per AggTrade: " << (print_ms.count() / trade_count) << "ms\n";
+
+    // ---------------------------------------------------------------------------------------------------------
+    // Option 2
+    // ---------------------------------------------------------------------------------------------------------
+
+    MyTradeBuffer trades(LIMIT); // reused for every response, see MyTradeBuffer::clear()
+    MyAdaptiveAggTradeParser adaptive_parser;
+    chrono_tp parse_t1 = chrono_clock::now();
+    parse_aggtrade_json(data, trades, adaptive_parser);
+    chrono_tp parse_t2 = chrono_clock::now();
+    duration<double, std::milli> parse_ms = parse_t2 - parse_t1; // milliseconds as double
+
+    stats_stream << "\n--------------------------------\n"
+                 << "Option 2: \"Object-Parser\"\n"
+                 << "---\n"
+                 << "Total Time: " << parse_ms.count() << "ms\n"
+                 << "Nr. of AggTrade: " << trades.size() << '\n'
+                 << "Time per AggTrade: " << (parse_ms.count() / trades.size()) << "ms\n"
+                 << "Fast/general path objects: " << adaptive_parser.get_stats().fast_objects << '/' << adaptive_parser.get_stats().general_objects << '\n';
+    *output_stream << "AggTrades Option 2:\n";
+    chrono_tp print_trades_t1 = chrono_clock::now();
+    print_aggtrades(trades, format, *output_stream);
+    duration<double, std::milli> print_trades_ms = chrono_clock::now() - print_trades_t1;
+    stats_stream << "Print Time: " << print_trades_ms.count() << "ms\n";
+
+    // ---------------------------------------------------------------------------------------------------------
+    // Option 3
+    // ---------------------------------------------------------------------------------------------------------
+
+    MyAggTradeParser parser(SCALE);
+    MyTradeBuffer index_trades(LIMIT);
+    chrono_tp index_t1 = chrono_clock::now();
+    bool index_ok = parser.parse(data, index_trades);
+    chrono_tp index_t2 = chrono_clock::now();
+    duration<double, std::milli> index_ms = index_t2 - index_t1; // milliseconds as double
+    if (!index_ok || index_trades.size() != trade_count)
+    {
+        cerr << "ERROR: Option 3 parsed " << index_trades.size() << " of " << trade_count << " AggTrades!" << endl;
+    }
+
+    stats_stream << "\n--------------------------------\n"
+                 << "Option 3: \"Structural-Index-Parser\"\n"
+                 << "---\n"
+                 << "Total Time: " << index_ms.count() << "ms\n"
+                 << "Nr. of AggTrade: " << index_trades.size() << '\n'
+                 << "Nr. of structural characters: " << parser.get_structural_count() << '\n'
+                 << "Time per AggTrade: " << (index_ms.count() / index_trades.size()) << "ms\n";
+    *output_stream << "AggTrades Option 3:\n";
+    chrono_tp print_index_t1 = chrono_clock::now();
+    print_aggtrades(index_trades, SCALE, format, *output_stream);
+    duration<double, std::milli> print_index_ms = chrono_clock::now() - print_index_t1;
+    stats_stream << "Print Time: " << print_index_ms.count() << "ms\n";
+    if (!archive_file.empty())
+    {
+        MyTradeArchiveWriter archive;
+        bool archive_ok = archive.open(archive_file.c_str(), SCALE);
+        if (archive_ok)
+        {
+            archive.write(index_trades);
+            archive_ok = archive.close();
+        }
+        if (!archive_ok)
+        {
+            cerr << "ERROR: Cannot write the archive " << archive_file << endl;
+        }
+    }
+    MyTradeAggregator aggregator(AGGREGATION_WINDOWS);
+    chrono_tp aggregate_t1 = chrono_clock::now();
+    aggregator.add(index_trades);
+    duration<double, std::milli> aggregate_ms = chrono_clock::now() - aggregate_t1;
+    stats_stream << "Aggregation Time: " << aggregate_ms.count() << "ms\n";
+    print_aggregation(aggregator, SCALE, stats_stream);
+
+    if (stream_trades.size() != trade_count)
+    {
+        cerr << "ERROR: Option 4 parsed " << stream_trades.size() << " of " << trade_count << " AggTrades!" << endl;
+    }
+    stats_stream << "\n--------------------------------\n"
+                 << "Option 4: \"Stream-Parser\" (during the download)\n"
+                 << "---\n"
+                 << "Download Time: " << stream_ms.count() << "ms (or replay)\n"
+                 << "Time to first AggTrade: " << first_trade_ms.count() << "ms\n"
+                 << "Parse Time: " << stream_parse_ms.count() << "ms\n"
+                 << "Nr. of chunks: " << chunk_count << '\n'
+                 << "Nr. of AggTrade: " << stream_trades.size() << '\n'
+                 << "Time per AggTrade: " << (stream_parse_ms.count() / stream_trades.size()) << "ms\n";
+
+    // ---------------------------------------------------------------------------------------------------------
+    // Result: Print statistics
+    // ---------------------------------------------------------------------------------------------------------
+    *output_stream << stats_stream.str() << '\n';
+    if (REDIRECT_FILEOUT)
+    {
+        delete output_stream; // flush and close the file
+        cout << "Part 2 done, see: " << FILE_NAME << endl;
+    }
+}
+
+/// @brief Print the trades from their JSON response and return the number of parsed trades.
+/// @param json AggTrade data as JSON string.
+/// @param out Output stream
+/// @return Nr of trades as size_t
+size_t print_aggtrade_json(const string &json, ostream &out)
+{
+    MyOutputBuffer buffer(out); // one write() per MB instead of one per character
+    size_t i = 0;
+    size_t trade_count = 0;
+    while (i < json.length())
+    {
+        if (json[i] == '[')
+        {
+            buffer.append("[\n");
+        }
+        else if (json[i] == ']')
+        {
+            buffer.append("\n]\n");
+        }
+        else if (json[i] == '{')
+        {
+            trade_count++;
+            buffer.append("  {\n    ");
+        }
+        else if (json[i] == '}')
+        {
+            buffer.append("\n  }");
+        }
+        else if (json[i] == ',')
+        {
+            if (json[i + 1] == '\"')
+            {
+                buffer.append(",\n    ");
+            }
+            else
+            {
+                buffer.append(",\n");
+            }
+        }
+        else if (json[i] == ':')
+        {
+            buffer.append(": ");
+        }
+        else
+        {
+            buffer.append(json[i]);
+        }
+        i++;
+    }
+    return trade_count;
+}
+
+/// @brief Print all AggTrades with prices and quantities as double (8 decimal places), the buffer is not changed.
+/// @param trades Buffer of AggTrades.
+/// @param format Pretty JSON, NDJSON or CSV.
+/// @param out Output stream.
+void print_aggtrades(const MyTradeBuffer &trades, MyOutputFormat format, ostream &out)
+{
+    MyTradeFormatter formatter(out, format);
+    formatter.write(trades);
+    formatter.finish();
+}
+
+/// @brief Print AggTrades with exact prices and quantities, i.e. as they were received.
+/// @param trades AggTrades parsed with a scale (PriceTicks and QuantityTicks are set), not changed.
+/// @param scale Decimal places of price and quantity.
+/// @param format Pretty JSON, NDJSON or CSV.
+/// @param out Output stream.
+void print_aggtrades(const MyTradeBuffer &trades, MyDecimalScale scale, MyOutputFormat format, ostream &out)
+{
+    MyTradeFormatter formatter(out, format, scale);
+    formatter.write(trades);
+    formatter.finish();
+}
+
+/// @brief Parse a JSON string of AggTrades, see MyAdaptiveAggTradeParser.
+/// @param json Contains the AggTrades.
+/// @param trades Cleared and filled with the parsed AggTrades, its memory is reused.
+/// @param parser Counts the objects of the fast and the general path.
+/// @return False if the response is an error of the API or malformed, trades holds the AggTrades before the error.
+bool parse_aggtrade_json(const string &json, MyTradeBuffer &trades, MyAdaptiveAggTradeParser &parser)
+{
+    trades.clear();
+    if (parser.parse(json, trades))
+    {
+        return true;
+    }
+    if (parser.get_error_code() != 0)
+    {
+        cerr << "ERROR: The API returned " << parser.get_error_code() << ": " << parser.get_error_message() << endl;
+    }
+    else
+    {
+        cerr << "ERROR: The JSON is malformed or an AggTrade misses a field, parsed " << trades.size() << " AggTrades!" << endl;
+    }
+    return false;
+}
+
+/// @brief Download the trades [from_id, to_id] with several requests at once and print the statistics.
+/// @param base_url E.g. "https://fapi.binance.com".
+/// @param from_id
+/// @param to_id
+/// @param threads Number of requests at once.
+/// @param archive_file Empty or the archive the trades are stored in.
+/// @param out Output stream.
+void run_backfill(const string &base_url, unsigned long long from_id, unsigned long long to_id, unsigned threads, const string &archive_file, ostream &out)
+{
+    MyBackfill<MyCprFetcher> backfill(base_url, SYMBOL, SCALE, threads);
+    MyTradeArchiveWriter archive;
+    if (!archive_file.empty() && !archive.open(archive_file.c_str(), SCALE))
+    {
+        cerr << "ERROR: Cannot write the archive " << archive_file << endl;
+    }
+    // The trades are only summarized, a backfill may have more trades than fit into memory.
+    double notional = 0;
+    double volume = 0;
+    time_t first_time = 0;
+    time_t last_time = 0;
+    MyTradeAggregator aggregator(AGGREGATION_WINDOWS);
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    MyBackfillStats stats = backfill.run(from_id, to_id, [&](const AggTrade &trade)
+                                         {
+        if (archive.is_open())
+        {
+            archive.write(trade);
+        }
+        aggregator.add(trade);
+        notional += trade.Price * trade.Quantity;
+        volume += trade.Quantity;
+        first_time = first_time == 0 ? trade.Timestamp : first_time;
+        last_time = trade.Timestamp; });
+    if (archive.is_open() && !archive.close())
+    {
+        cerr << "ERROR: Cannot write the archive " << archive_file << endl;
+    }
+    chrono::duration<double> seconds = chrono::steady_clock::now() - t1;
+    if (stats.failed)
+    {
+        cerr << "ERROR: The backfill stopped at a page that failed " << MY_BACKFILL_MAX_ATTEMPTS << " times!" << endl;
+    }
+
+    out << "\n--------------------------------\n"
+        << "Backfill of " << SYMBOL << " from id " << from_id << " to " << to_id << " (" << threads << " threads)\n"
+        << "---\n"
+        << "Total Time: " << seconds.count() * 1000 << "ms\n"
+        << "Nr. of AggTrade: " << stats.trades << '\n'
+        << "AggTrades per second: " << (stats.trades / seconds.count()) << '\n'
+        << "Nr. of pages: " << stats.pages << '\n'
+        << "Nr. of requests: " << stats.requests << " (retries: " << stats.retries << ", rate limited: " << stats.rate_limited << ")\n"
+        << "Duplicate AggTrades: " << stats.duplicates << '\n'
+        << "Missing ids: " << stats.missing << '\n'
+        << "VWAP: " << (volume > 0 ? notional / volume : 0) << '\n'
+        << "Time range: " << first_time << " - " << last_time << '\n';
+    print_aggregation(aggregator, SCALE, out);
+}
+
+/// @brief Download the trades [from_id, to_id] with MyPipeline, print them and the statistics of every stage.
+/// @param base_url E.g. "https://fapi.binance.com".
+/// @param from_id
+/// @param to_id
+/// @param threads Number of fetch threads.
+/// @param pin Bind the threads of the stages to CPUs.
+/// @param format Pretty JSON, NDJSON or CSV.
+/// @param archive_file Empty or the archive the trades are stored in.
+/// @param out Output stream.
+void run_pipeline(const string &base_url, unsigned long long from_id, unsigned long long to_id, unsigned threads, bool pin, MyOutputFormat format, const string &archive_file, ostream &out)
+{
+    MyPipelineOptions options;
+    options.fetch_threads = threads;
+    options.pin_threads = pin;
+    MyPipeline<MyCprFetcher> pipeline(base_url, SYMBOL, SCALE, options);
+    MyTradeArchiveWriter archive;
+    if (!archive_file.empty() && !archive.open(archive_file.c_str(), SCALE))
+    {
+        cerr << "ERROR: Cannot write the archive " << archive_file << endl;
+    }
+    // The sink stage: format the trades, store them and sum up the VWAP, one page at a time.
+    MyTradeFormatter formatter(out, format, SCALE);
+    MyTradeAggregator aggregator(AGGREGATION_WINDOWS);
+    double notional = 0;
+    double volume = 0;
+    MyPipelineStats stats = pipeline.run(from_id, to_id, [&](const MyTradeBuffer &trades)
+                                         {
+        formatter.write(trades);
+        if (archive.is_open())
+        {
+            archive.write(trades);
+        }
+        aggregator.add(trades);
+        for (size_t i = 0; i < trades.size(); i++)
+        {
+            notional += trades.get_prices()[i] * trades.get_quantities()[i];
+            volume += trades.get_quantities()[i];
+        } });
+    formatter.finish();
+    if (archive.is_open() && !archive.close())
+    {
+        cerr << "ERROR: Cannot write the archive " << archive_file << endl;
+    }
+    if (stats.backfill.failed)
+    {
+        cerr << "ERROR: The backfill stopped at a page that failed " << MY_BACKFILL_MAX_ATTEMPTS << " times!" << endl;
+    }
+
+    double seconds = stats.seconds > 0 ? stats.seconds : 1;
+    out << "\n--------------------------------\n"
+        << "Pipeline backfill of " << SYMBOL << " from id " << from_id << " to " << to_id << " (" << threads << " fetch threads" << (pin ? ", pinned" : "") << ")\n"
+        << "---\n"
+        << "Total Time: " << stats.seconds * 1000 << "ms\n"
+        << "Nr. of AggTrade: " << stats.backfill.trades << '\n'
+        << "AggTrades per second: " << (stats.backfill.trades / seconds) << '\n'
+        << "Nr. of pages: " << stats.backfill.pages << '\n'
+        << "Nr. of requests: " << stats.backfill.requests << " (retries: " << stats.backfill.retries << ", rate limited: " << stats.backfill.rate_limited << ")\n"
+        << "Duplicate AggTrades: " << stats.backfill.duplicates << '\n'
+        << "Missing ids: " << stats.backfill.missing << '\n'
+        << "VWAP: " << (volume > 0 ? notional / volume : 0) << '\n'
+        << "---\n"
+        << "Utilization: fetch " << 100 * stats.fetch_busy / (seconds * max(1u, threads)) << "%, parse " << 100 * stats.parse_busy / seconds
+        << "%, sink " << 100 * stats.sink_busy / seconds << "%\n";
+    const pair<const char *, const MyLatencyHistogram *> histograms[] = {
+        {"Fetch", &stats.fetch}, {"Parse queue", &stats.parse_wait}, {"Parse", &stats.parse},
+        {"Sink queue", &stats.sink_wait}, {"Sink", &stats.sink}, {"End to end", &stats.end_to_end}};
+    for (const auto &histogram : histograms)
+    {
+        out << histogram.first << ": ";
+        histogram.second->print_us(out);
+        out << '\n';
+    }
+    print_aggregation(aggregator, SCALE, out);
+}
+
+/// @brief Print per window of the aggregator the number of bars, the current bar and the rolling VWAP/imbalance.
+/// @param aggregator
+/// @param scale Decimal places the trades were parsed with.
+/// @param out Output stream.
+void print_aggregation(const MyTradeAggregator &aggregator, MyDecimalScale scale, ostream &out)
+{
+    char text[MY_DECIMAL_BUFFER_SIZE];
+    auto decimal = [&](int64_t ticks, unsigned decimals)
+    { return string(text, my_format_decimal(ticks, decimals, text)); };
+    out << "---\n";
+    for (size_t w = 0; w < aggregator.get_window_count(); w++)
+    {
+        MyWindow window = aggregator.get_window(w);
+        vector<MyBar> bars;
+        MyBar bar;
+        aggregator.get_bars(w, bars);
+        if (!aggregator.get_bar(w, bar))
+        {
+            continue;
+        }
+        MyTradeTotals rolling = aggregator.get_rolling(w);
+        out << "Bars of " << window.size << (window.type == MY_WINDOW_TIME ? "ms" : " trades") << ": " << bars.size() + 1
+            << ", last: O " << decimal(bar.open, scale.price) << " H " << decimal(bar.high, scale.price)
+            << " L " << decimal(bar.low, scale.price) << " C " << decimal(bar.close, scale.price)
+            << " V " << decimal(bar.totals.volume, scale.quantity) << " (" << bar.totals.trade_count << " trades)"
+            << ", rolling VWAP: " << rolling.get_vwap() / (double)MY_POW10[scale.price]
+            << ", imbalance: " << rolling.get_imbalance() << '\n';
+    }
+}
+
+/// @brief Poll the new trades of many symbols over a shared pool of connections and print the statistics per symbol.
+/// @param base_url E.g. "https://fapi.binance.com".
+/// @param symbols Comma separated, e.g. "BTCUSDT:2:3,ETHUSDT". Without decimal places MY_MULTI_SYMBOL_DEFAULT_SCALE is used.
+/// @param polls Number of polls, MULTI_SYMBOL_POLL_INTERVAL_MS apart.
+/// @param threads Number of connections.
+/// @param out Output stream.
+void run_multi_symbol(const string &base_url, const string &symbols, unsigned polls, unsigned threads, ostream &out)
+{
+    MyMultiSymbolOptions options;
+    options.connections = threads;
+    MyMultiSymbolIngest<MyCprFetcher> ingest(base_url, options);
+    stringstream list(symbols);
+    string entry;
+    while (getline(list, entry, ','))
+    {
+        size_t colon = entry.find(':');
+        MyDecimalScale scale = MY_MULTI_SYMBOL_DEFAULT_SCALE;
+        if (colon != string::npos)
+        {
+            unsigned price = 0;
+            unsigned quantity = 0;
+            if (sscanf(entry.c_str() + colon, ":%u:%u", &price, &quantity) == 2)
+            {
+                scale = {min(price, MY_DECIMAL_MAX_SCALE), min(quantity, MY_DECIMAL_MAX_SCALE)};
+            }
+            entry.resize(colon);
+        }
+        if (!entry.empty())
+        {
+            ingest.add_symbol(entry, scale);
+        }
+    }
+
+    out << "\n--------------------------------\n"
+        << "Multi-symbol polls of " << ingest.get_symbol_count() << " symbols (" << max(1u, threads) << " connections)\n"
+        << "---\n";
+    if (!ingest.freeze())
+    {
+        out << "Symbol index could not be frozen, lookups use the hash table\n";
+    }
+    for (unsigned poll = 0; poll < polls; poll++)
+    {
+        if (poll > 0)
+        {
+            this_thread::sleep_for(chrono::milliseconds(MULTI_SYMBOL_POLL_INTERVAL_MS));
+        }
+        MyMultiSymbolStats stats = ingest.poll([](const MySymbolState &, const MyTradeBuffer &) {});
+        out << "Poll " << poll + 1 << ": " << stats.seconds * 1000 << "ms, AggTrades: " << stats.trades << ", requests: " << stats.requests
+            << " (retries: " << stats.retries << ", rate limited: " << stats.rate_limited << ", failed: " << stats.failed << ")\n";
+    }
+    out << "---\n";
+    for (uint32_t i = 0; i < ingest.get_symbol_count(); i++)
+    {
+        const MySymbolState &state = ingest.get_state(i);
+        out << state.symbol << ": AggTrades: " << state.stats.trades << ", next id: " << state.next_id
+            << ", VWAP: " << (state.stats.volume > 0 ? state.stats.notional / state.stats.volume : 0)
+            << ", missing ids: " << state.stats.missing << ", requests: " << state.stats.requests
+            << (state.stats.failed > 0 ? ", FAILED pages: " + to_string(state.stats.failed) : "") << '\n';
+    }
+}
+
+/// @brief Print the trades of an archive in a time range and the statistics of the load.
+/// @param archive_file Written with --archive.
+/// @param from_time Milliseconds since the epoch.
+/// @param to_time
+/// @param format Pretty JSON, NDJSON or CSV.
+/// @param out Output stream.
+/// @return False if the archive cannot be read or is corrupt.
+bool load_archive(const string &archive_file, int64_t from_time, int64_t to_time, MyOutputFormat format, ostream &out)
+{
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    MyTradeArchiveReader archive;
+    if (!archive.open(archive_file.c_str()))
+    {
+        cerr << "ERROR: Cannot read the archive " << archive_file << endl;
+        return false;
+    }
+    MyTradeBuffer trades;
+    bool ok = archive.query_time(from_time, to_time, [&](const AggTrade &trade)
+                                 { trades.push_back(trade); });
+    chrono::duration<double, std::milli> load_ms = chrono::steady_clock::now() - t1;
+    if (!ok)
+    {
+        cerr << "ERROR: The archive " << archive_file << " is corrupt!" << endl;
+    }
+
+    out << "AggTrades of " << archive_file << ":\n";
+    print_aggtrades(trades, archive.get_scale(), format, out);
+    out << "\n--------------------------------\n"
+        << "Archive: " << archive_file << '\n'
+        << "---\n"
+        << "Load Time: " << load_ms.count() << "ms\n"
+        << "Nr. of AggTrade: " << trades.size() << " of " << archive.get_trade_count() << '\n'
+        << "Nr. of blocks: " << archive.get_block_count() << '\n'
+        << "Bytes per AggTrade: " << (double)archive.get_file_size() / max<uint64_t>(archive.get_trade_count(), 1) << '\n'
+        << "Time per AggTrade: " << (load_ms.count() / trades.size()) << "ms\n";
+    return ok;
+}